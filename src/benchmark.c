@@ -0,0 +1,590 @@
+// benchmark.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://www.man7.org/linux/man-pages/man2/perf_event_open.2.html
+//  - https://www.man7.org/linux/man-pages/man3/clock_gettime.3.html
+//  - https://en.wikipedia.org/wiki/Xorshift
+
+// syscall, clock_gettime in <benchmark.c>: _GNU_SOURCE
+
+#define _GNU_SOURCE
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "encoder.h"
+#include "task.h"
+#define BENCHMARK_SIZE (1 << 24)
+#define BENCHMARK_REPETITIONS 5
+#define BENCHMARK_COUNTERS 3
+
+/** Represents the counters of one measurement. Without hardware counters, only
+ *  the elapsed time is measured. */
+struct BenchmarkSample
+{
+    double nanoseconds;
+    unsigned long long cycles;
+    unsigned long long instructions;
+    unsigned long long branchMisses;
+};
+
+/** */
+typedef struct BenchmarkSample BenchmarkSample;
+
+/** Represents a group of hardware counters led by the cycle counter. */
+struct BenchmarkCounters
+{
+    int descriptors[BENCHMARK_COUNTERS];
+};
+
+/** */
+typedef struct BenchmarkCounters* BenchmarkCounters;
+
+/** Represents a kernel under measurement. */
+struct BenchmarkKernel
+{
+    const char* name;
+    void (*run)(unsigned char input[], off_t size, unsigned char width);
+};
+
+/** Represents a generator of inputs with a controlled run-length
+ *  distribution. */
+struct BenchmarkDistribution
+{
+    const char* name;
+    void (*fill)(unsigned char input[], off_t size, unsigned char width);
+};
+
+static unsigned char* benchmarkOutput;
+static uint64_t benchmarkState = 0x9e3779b97f4a7c15;
+
+static uint64_t benchmark_random(void)
+{
+    benchmarkState ^= benchmarkState << 13;
+    benchmarkState ^= benchmarkState >> 7;
+    benchmarkState ^= benchmarkState << 17;
+
+    return benchmarkState;
+}
+
+static void benchmark_fill_uniform(
+    unsigned char input[],
+    off_t size,
+    unsigned char width)
+{
+    (void)width;
+
+    for (off_t i = 0; i < size; i++)
+    {
+        input[i] = benchmark_random();
+    }
+}
+
+static void benchmark_fill_geometric(
+    unsigned char input[],
+    off_t size,
+    unsigned char width)
+{
+    // Each symbol is repeated a geometric number of times with a mean of 8:
+    // the run continues with a probability of 7/8.
+
+    off_t i = 0;
+
+    while (i < size)
+    {
+        uint64_t symbol = benchmark_random();
+
+        do
+        {
+            for (int j = 0; j < width && i < size; j++, i++)
+            {
+                input[i] = symbol >> (8 * j);
+            }
+        }
+        while (benchmark_random() % 8);
+    }
+}
+
+static void benchmark_fill_same(
+    unsigned char input[],
+    off_t size,
+    unsigned char width)
+{
+    (void)width;
+
+    memset(input, 'a', size);
+}
+
+static void benchmark_fill_alternating(
+    unsigned char input[],
+    off_t size,
+    unsigned char width)
+{
+    for (off_t i = 0; i < size; i++)
+    {
+        input[i] = (i / width) % 2 ? 'b' : 'a';
+    }
+}
+
+static void benchmark_run_encode(
+    unsigned char input[],
+    off_t size,
+    unsigned char width)
+{
+    for (off_t offset = 0; offset < size; offset += TASK_SIZE)
+    {
+        Encoder value;
+
+        encoder(&value, width);
+        encoder_encode(benchmarkOutput, &value, input + offset, TASK_SIZE);
+    }
+}
+
+static void benchmark_run_next_encode(
+    unsigned char input[],
+    off_t size,
+    unsigned char width)
+{
+    Encoder value;
+    MappedFile mappedFile =
+    {
+        .buffer = input,
+        .size = size
+    };
+
+    encoder(&value, width);
+    encoder_next_encode(&value, mappedFile, stdout);
+    encoder_end_encode(value, stdout);
+}
+
+static void benchmark_run_task(
+    unsigned char input[],
+    off_t size,
+    unsigned char width)
+{
+    TaskOptions options =
+    {
+        .width = width
+    };
+
+    for (off_t offset = 0; offset < size; offset += TASK_SIZE)
+    {
+        struct Task task =
+        {
+            .inputSize = TASK_SIZE,
+            .input = input + offset,
+            .output = benchmarkOutput
+        };
+
+        task_execute(&task, options);
+    }
+}
+
+static bool benchmark_counters(BenchmarkCounters instance)
+{
+    unsigned long long configs[BENCHMARK_COUNTERS] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    int leader = -1;
+
+    for (int i = 0; i < BENCHMARK_COUNTERS; i++)
+    {
+        struct perf_event_attr attributes;
+
+        memset(&attributes, 0, sizeof attributes);
+
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof attributes;
+        attributes.config = configs[i];
+        attributes.disabled = leader == -1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+
+        int descriptor = syscall(
+            SYS_perf_event_open,
+            &attributes,
+            0,
+            -1,
+            leader,
+            0);
+
+        if (descriptor == -1)
+        {
+            for (int j = 0; j < i; j++)
+            {
+                close(instance->descriptors[j]);
+            }
+
+            return false;
+        }
+
+        if (leader == -1)
+        {
+            leader = descriptor;
+        }
+
+        instance->descriptors[i] = descriptor;
+    }
+
+    return true;
+}
+
+static void finalize_benchmark_counters(BenchmarkCounters instance)
+{
+    for (int i = 0; i < BENCHMARK_COUNTERS; i++)
+    {
+        close(instance->descriptors[i]);
+    }
+}
+
+static double benchmark_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static BenchmarkSample benchmark_measure(
+    struct BenchmarkKernel kernel,
+    BenchmarkCounters counters,
+    unsigned char input[],
+    unsigned char width)
+{
+    BenchmarkSample result = { 0 };
+    int leader = -1;
+
+    if (counters)
+    {
+        leader = counters->descriptors[0];
+
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    double start = benchmark_now();
+
+    kernel.run(input, BENCHMARK_SIZE, width);
+
+    result.nanoseconds = benchmark_now() - start;
+
+    if (counters)
+    {
+        unsigned long long values[BENCHMARK_COUNTERS];
+
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        for (int i = 0; i < BENCHMARK_COUNTERS; i++)
+        {
+            if (read(counters->descriptors[i], values + i, sizeof * values) !=
+                sizeof * values)
+            {
+                values[i] = 0;
+            }
+        }
+
+        result.cycles = values[0];
+        result.instructions = values[1];
+        result.branchMisses = values[2];
+    }
+
+    return result;
+}
+
+static bool benchmark_baseline(
+    FILE* input,
+    const char* kernel,
+    unsigned long width,
+    const char* distribution,
+    const char* unit,
+    double* result)
+{
+    char kernelName[64];
+    char distributionName[64];
+    char unitName[64];
+    unsigned long symbolWidth;
+    double value;
+
+    rewind(input);
+
+    while (fscanf(
+        input,
+        "%63s %lu %63s %lf %63s",
+        kernelName,
+        &symbolWidth,
+        distributionName,
+        &value,
+        unitName) == 5)
+    {
+        if (!strcmp(kernelName, kernel) &&
+            symbolWidth == width &&
+            !strcmp(distributionName, distribution) &&
+            !strcmp(unitName, unit))
+        {
+            *result = value;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void benchmark_print_usage(FILE* output, char* args[])
+{
+    fprintf(
+        output,
+        "Usage: %s [-b BASELINE] [-s BASELINE] [-t TOLERANCE] [-w WIDTH]\n",
+        args[0]);
+}
+
+int main(int count, char* args[])
+{
+    static const struct BenchmarkKernel kernels[] =
+    {
+        { "encoder_encode", benchmark_run_encode },
+        { "encoder_next_encode", benchmark_run_next_encode },
+        { "task_execute", benchmark_run_task }
+    };
+    static const struct BenchmarkDistribution distributions[] =
+    {
+        { "uniform", benchmark_fill_uniform },
+        { "geometric", benchmark_fill_geometric },
+        { "same", benchmark_fill_same },
+        { "alternating", benchmark_fill_alternating }
+    };
+    int option;
+    unsigned long width = 1;
+    double tolerance = 0.1;
+    char* baselinePath = NULL;
+    char* savePath = NULL;
+
+    while ((option = getopt(count, args, "b:hs:t:w:")) != -1)
+    {
+        switch (option)
+        {
+        case 'b':
+            baselinePath = optarg;
+            break;
+
+        case 'h':
+            benchmark_print_usage(stdout, args);
+
+            return EXIT_SUCCESS;
+
+        case 's':
+            savePath = optarg;
+            break;
+
+        case 't':
+            tolerance = strtod(optarg, NULL);
+            break;
+
+        case 'w':
+            width = strtoul(optarg, NULL, 10);
+
+            if (width < 1 ||
+                width > ENCODER_MAX_WIDTH ||
+                (width & (width - 1)))
+            {
+                benchmark_print_usage(stderr, args);
+
+                return EXIT_FAILURE;
+            }
+            break;
+
+        default: return EXIT_FAILURE;
+        }
+    }
+
+    // The stream kernel writes to standard output, so the report is written
+    // to a duplicate of the original standard output.
+
+    int reportDescriptor = dup(STDOUT_FILENO);
+    FILE* report = NULL;
+    FILE* baseline = NULL;
+    FILE* save = NULL;
+    unsigned char* input = malloc(BENCHMARK_SIZE);
+
+    benchmarkOutput = malloc(TASK_OUTPUT_SIZE);
+
+    if (reportDescriptor != -1)
+    {
+        report = fdopen(reportDescriptor, "w");
+    }
+
+    if (!report ||
+        !input ||
+        !benchmarkOutput ||
+        !freopen("/dev/null", "w", stdout))
+    {
+        perror(args[0]);
+
+        return EXIT_FAILURE;
+    }
+
+    if (baselinePath && !(baseline = fopen(baselinePath, "r")))
+    {
+        fprintf(stderr, "%s: %s: %s\n", args[0], baselinePath, strerror(errno));
+
+        return EXIT_FAILURE;
+    }
+
+    if (savePath && !(save = fopen(savePath, "w")))
+    {
+        fprintf(stderr, "%s: %s: %s\n", args[0], savePath, strerror(errno));
+
+        return EXIT_FAILURE;
+    }
+
+    struct BenchmarkCounters counters;
+    BenchmarkCounters hardware = NULL;
+    const char* unit = "ns/B";
+
+    if (benchmark_counters(&counters))
+    {
+        hardware = &counters;
+        unit = "cycles/B";
+    }
+    else
+    {
+        fprintf(
+            stderr,
+            "%s: hardware counters unavailable, timing only: %s\n",
+            args[0],
+            strerror(errno));
+    }
+
+    bool result = true;
+    int kernelCount = sizeof kernels / sizeof * kernels;
+    int distributionCount = sizeof distributions / sizeof * distributions;
+
+    fprintf(
+        report,
+        "%-20s %-12s %10s %-8s %6s %12s\n",
+        "kernel",
+        "distribution",
+        "value",
+        "unit",
+        "IPC",
+        "misses/KiB");
+
+    for (int i = 0; i < distributionCount; i++)
+    {
+        distributions[i].fill(input, BENCHMARK_SIZE, width);
+
+        for (int j = 0; j < kernelCount; j++)
+        {
+            BenchmarkSample best = { 0 };
+
+            // The fastest of several repetitions is the least disturbed by
+            // other activity on the host.
+
+            for (int k = 0; k < BENCHMARK_REPETITIONS; k++)
+            {
+                BenchmarkSample sample = benchmark_measure(
+                    kernels[j],
+                    hardware,
+                    input,
+                    width);
+
+                if (!k || sample.nanoseconds < best.nanoseconds)
+                {
+                    best = sample;
+                }
+            }
+
+            double value = best.nanoseconds / BENCHMARK_SIZE;
+            double ipc = 0;
+            double misses = 0;
+
+            if (hardware)
+            {
+                value = (double)best.cycles / BENCHMARK_SIZE;
+                misses = best.branchMisses * 1024.0 / BENCHMARK_SIZE;
+
+                if (best.cycles)
+                {
+                    ipc = (double)best.instructions / best.cycles;
+                }
+            }
+
+            const char* kernel = kernels[j].name;
+            const char* distribution = distributions[i].name;
+            double expected;
+            const char* status = "";
+
+            if (baseline &&
+                benchmark_baseline(
+                    baseline,
+                    kernel,
+                    width,
+                    distribution,
+                    unit,
+                    &expected) &&
+                value > expected * (1 + tolerance))
+            {
+                status = " REGRESSION";
+                result = false;
+            }
+
+            fprintf(
+                report,
+                "%-20s %-12s %10.4f %-8s %6.2f %12.2f%s\n",
+                kernel,
+                distribution,
+                value,
+                unit,
+                ipc,
+                misses,
+                status);
+
+            if (save)
+            {
+                fprintf(
+                    save,
+                    "%s %lu %s %f %s\n",
+                    kernel,
+                    width,
+                    distribution,
+                    value,
+                    unit);
+            }
+        }
+    }
+
+    if (hardware)
+    {
+        finalize_benchmark_counters(hardware);
+    }
+
+    if (baseline)
+    {
+        fclose(baseline);
+    }
+
+    if (save && fclose(save) == EOF)
+    {
+        perror(args[0]);
+
+        result = false;
+    }
+
+    fclose(report);
+    free(input);
+    free(benchmarkOutput);
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,91 @@
+// block_table.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+//  - https://preshing.com/20130605/the-worlds-simplest-lock-free-hash-table/
+
+#include <stdlib.h>
+#include <string.h>
+#include "block_table.h"
+#define BLOCK_TABLE_MIN_CAPACITY 16
+
+bool block_table(BlockTable instance, struct Task items[], size_t count)
+{
+    size_t capacity = BLOCK_TABLE_MIN_CAPACITY;
+
+    while (capacity < 2 * count)
+    {
+        capacity *= 2;
+    }
+
+    size_t* slots = calloc(capacity, sizeof * slots);
+
+    if (!slots)
+    {
+        return false;
+    }
+
+    instance->capacity = capacity;
+    instance->slots = slots;
+    instance->items = items;
+
+    return true;
+}
+
+static bool block_table_equals(Task item, Task other)
+{
+    return item->hash == other->hash &&
+        item->inputSize == other->inputSize &&
+        !memcmp(item->input, other->input, item->inputSize);
+}
+
+size_t block_table_add(BlockTable instance, Task item)
+{
+    size_t mask = instance->capacity - 1;
+    size_t desired = item->id + 1;
+
+    for (size_t i = item->hash & mask; ; i = (i + 1) & mask)
+    {
+        size_t* slot = instance->slots + i;
+        size_t expected = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+        // The slot is either empty, holds a different input, or holds an
+        // identical input. Keep the smallest identifier so that references
+        // always point backward.
+
+        for (;;)
+        {
+            if (expected &&
+                !block_table_equals(item, instance->items + expected - 1))
+            {
+                break;
+            }
+
+            if (expected && expected < desired)
+            {
+                return expected - 1;
+            }
+
+            if (__atomic_compare_exchange_n(
+                slot,
+                &expected,
+                desired,
+                false,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_ACQUIRE))
+            {
+                return item->id;
+            }
+        }
+    }
+}
+
+void finalize_block_table(BlockTable instance)
+{
+    free(instance->slots);
+
+    instance->capacity = 0;
+    instance->slots = NULL;
+}
@@ -0,0 +1,50 @@
+// block_table.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+#ifndef BLOCK_TABLE_3a46107799d2435d874fd3feda1f07d9
+#define BLOCK_TABLE_3a46107799d2435d874fd3feda1f07d9
+#include <stdbool.h>
+#include <stddef.h>
+#include "task.h"
+
+/** Represents a lock-free hash table that finds the first task whose input is
+ *  identical to that of another task. Each slot holds one more than the
+ *  identifier of a task, or zero if empty. */
+struct BlockTable
+{
+    size_t capacity;
+    size_t* slots;
+    struct Task* items;
+};
+
+/** */
+typedef struct BlockTable* BlockTable;
+
+/**
+ * 
+ * @param instance
+ * @param items the tasks whose inputs are compared.
+ * @param count the number of tasks.
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool block_table(BlockTable instance, struct Task items[], size_t count);
+
+/**
+ * Adds a task whose hash is computed. Tasks may be added concurrently and in
+ * any order.
+ * 
+ * @param instance
+ * @param item the task.
+ * @return The identifier of an earlier task with an identical input, or the
+ *         identifier of the task itself if no earlier task has been found.
+ */
+size_t block_table_add(BlockTable instance, Task item);
+
+/**
+ * 
+ * @param instance
+ */
+void finalize_block_table(BlockTable instance);
+
+#endif
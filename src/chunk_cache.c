@@ -0,0 +1,370 @@
+// chunk_cache.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://www.man7.org/linux/man-pages/man2/mmap.2.html
+//  - https://www.man7.org/linux/man-pages/man3/rename.3p.html
+//  - https://en.wikipedia.org/wiki/Linear_probing
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "chunk_cache.h"
+#define CHUNK_CACHE_MAGIC "NYUC"
+#define CHUNK_CACHE_VERSION 2
+#define CHUNK_CACHE_MIN_CAPACITY 16
+#define CHUNK_CACHE_MAX_LOAD 75
+
+/** Represents the header of a cache file. The header is followed by the index
+ *  slots and then by the encoded bytes. */
+struct ChunkCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t reserved;
+    uint64_t capacity;
+    uint64_t dataSize;
+};
+
+static void chunk_cache_clear(ChunkCache instance)
+{
+    instance->capacity = 0;
+    instance->slots = NULL;
+    instance->data = NULL;
+    instance->map = NULL;
+    instance->mapSize = 0;
+}
+
+static bool chunk_cache_validate_slot(
+    struct ChunkCacheSlot slot,
+    unsigned char width,
+    uint64_t dataSize)
+{
+    if (!slot.inputSize)
+    {
+        return true;
+    }
+
+    uint32_t recordSize = width + 1;
+
+    return slot.inputSize <= TASK_SIZE &&
+        slot.inputSize % width == 0 &&
+        slot.outputSize &&
+        slot.outputSize <= TASK_OUTPUT_SIZE &&
+        slot.outputSize % recordSize == 0 &&
+        slot.offset <= dataSize &&
+        slot.outputSize <= dataSize - slot.offset;
+}
+
+static bool chunk_cache_validate(ChunkCache instance)
+{
+    struct ChunkCacheHeader header;
+
+    if (instance->mapSize < sizeof header)
+    {
+        return false;
+    }
+
+    memcpy(&header, instance->map, sizeof header);
+
+    if (memcmp(header.magic, CHUNK_CACHE_MAGIC, sizeof header.magic) ||
+        header.version != CHUNK_CACHE_VERSION ||
+        header.width != instance->width ||
+        !header.capacity ||
+        (header.capacity & (header.capacity - 1)) ||
+        header.capacity > SIZE_MAX / sizeof * instance->slots)
+    {
+        return false;
+    }
+
+    size_t slotsSize = header.capacity * sizeof * instance->slots;
+
+    if (instance->mapSize - sizeof header < slotsSize ||
+        instance->mapSize - sizeof header - slotsSize != header.dataSize)
+    {
+        return false;
+    }
+
+    struct ChunkCacheSlot* slots =
+        (struct ChunkCacheSlot*)(instance->map + sizeof header);
+
+    for (size_t i = 0; i < header.capacity; i++)
+    {
+        if (!chunk_cache_validate_slot(
+            slots[i],
+            instance->width,
+            header.dataSize))
+        {
+            return false;
+        }
+    }
+
+    instance->capacity = header.capacity;
+    instance->slots = slots;
+    instance->data = instance->map + sizeof header + slotsSize;
+
+    return true;
+}
+
+bool chunk_cache(ChunkCache instance, char* path, unsigned char width)
+{
+    instance->path = path;
+    instance->width = width;
+
+    chunk_cache_clear(instance);
+
+    int descriptor = open(path, O_RDONLY);
+
+    if (descriptor == -1)
+    {
+        return errno == ENOENT;
+    }
+
+    struct stat status;
+
+    if (fstat(descriptor, &status) == -1)
+    {
+        close(descriptor);
+
+        return false;
+    }
+
+    if (status.st_size)
+    {
+        unsigned char* map = mmap(
+            NULL,
+            status.st_size,
+            PROT_READ,
+            MAP_PRIVATE,
+            descriptor,
+            0);
+
+        if (map == MAP_FAILED)
+        {
+            close(descriptor);
+
+            return false;
+        }
+
+        instance->map = map;
+        instance->mapSize = status.st_size;
+
+        if (!chunk_cache_validate(instance))
+        {
+            munmap(map, status.st_size);
+            chunk_cache_clear(instance);
+        }
+    }
+
+    return close(descriptor) != -1;
+}
+
+static struct ChunkCacheSlot* chunk_cache_probe(
+    struct ChunkCacheSlot slots[],
+    size_t capacity,
+    uint64_t hash,
+    off_t inputSize)
+{
+    size_t mask = capacity - 1;
+    size_t i = hash & mask;
+
+    for (size_t step = 0; step <= mask; step++)
+    {
+        struct ChunkCacheSlot* slot = slots + i;
+
+        if (!slot->inputSize ||
+            (slot->hash == hash && slot->inputSize == inputSize))
+        {
+            return slot;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return NULL;
+}
+
+unsigned char* chunk_cache_find(
+    ChunkCache instance,
+    uint64_t hash,
+    uint64_t secondaryHash,
+    off_t inputSize,
+    off_t* outputSize)
+{
+    if (!instance->capacity)
+    {
+        return NULL;
+    }
+
+    struct ChunkCacheSlot* slot = chunk_cache_probe(
+        instance->slots,
+        instance->capacity,
+        hash,
+        inputSize);
+
+    if (!slot || !slot->inputSize || slot->secondaryHash != secondaryHash)
+    {
+        return NULL;
+    }
+
+    *outputSize = slot->outputSize;
+
+    return instance->data + slot->offset;
+}
+
+static bool chunk_cache_write(
+    FILE* output,
+    struct ChunkCacheHeader header,
+    struct ChunkCacheSlot slots[],
+    struct Task items[],
+    size_t owners[],
+    size_t ownerCount)
+{
+    if (fwrite(&header, sizeof header, 1, output) != 1)
+    {
+        return false;
+    }
+
+    size_t capacity = header.capacity;
+
+    if (fwrite(slots, sizeof * slots, capacity, output) != capacity)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < ownerCount; i++)
+    {
+        Task item = items + owners[i];
+        size_t size = item->outputSize;
+
+        if (fwrite(item->output, 1, size, output) != size)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool chunk_cache_save(ChunkCache instance, struct Task items[], size_t count)
+{
+    struct ChunkCacheHeader header =
+    {
+        .version = CHUNK_CACHE_VERSION,
+        .width = instance->width,
+        .capacity = CHUNK_CACHE_MIN_CAPACITY
+    };
+
+    memcpy(header.magic, CHUNK_CACHE_MAGIC, sizeof header.magic);
+
+    while (header.capacity < 2 * count)
+    {
+        header.capacity *= 2;
+    }
+
+    struct ChunkCacheSlot* slots = calloc(header.capacity, sizeof * slots);
+    size_t* owners = NULL;
+    size_t pathLength = strlen(instance->path);
+    char* path = malloc(pathLength + sizeof ".tmp");
+
+    // An empty input still saves an empty cache, but has no owners to list.
+
+    if (count)
+    {
+        owners = malloc(count * sizeof * owners);
+    }
+
+    if (!slots || (count && !owners) || !path)
+    {
+        free(slots);
+        free(owners);
+        free(path);
+
+        return false;
+    }
+
+    size_t ownerCount = 0;
+    size_t limit = header.capacity * CHUNK_CACHE_MAX_LOAD / 100;
+
+    for (size_t i = 0; i < count && ownerCount < limit; i++)
+    {
+        Task item = items + i;
+
+        if (!item->input || item->reference != item->id)
+        {
+            continue;
+        }
+
+        struct ChunkCacheSlot* slot = chunk_cache_probe(
+            slots,
+            header.capacity,
+            item->hash,
+            item->inputSize);
+
+        if (!slot || slot->inputSize)
+        {
+            continue;
+        }
+
+        slot->hash = item->hash;
+        slot->secondaryHash = item->secondaryHash;
+        slot->offset = header.dataSize;
+        slot->inputSize = item->inputSize;
+        slot->outputSize = item->outputSize;
+        header.dataSize += item->outputSize;
+        owners[ownerCount] = i;
+        ownerCount++;
+    }
+
+    memcpy(path, instance->path, pathLength);
+    memcpy(path + pathLength, ".tmp", sizeof ".tmp");
+
+    FILE* output = fopen(path, "wb");
+    bool result = output != NULL;
+
+    if (result)
+    {
+        result = chunk_cache_write(
+            output,
+            header,
+            slots,
+            items,
+            owners,
+            ownerCount);
+        result = fclose(output) != EOF && result;
+        result = result && rename(path, instance->path) != -1;
+
+        if (!result)
+        {
+            int ex = errno;
+
+            remove(path);
+
+            errno = ex;
+        }
+    }
+
+    free(slots);
+    free(owners);
+    free(path);
+
+    return result;
+}
+
+void finalize_chunk_cache(ChunkCache instance)
+{
+    if (instance->map)
+    {
+        munmap(instance->map, instance->mapSize);
+    }
+
+    chunk_cache_clear(instance);
+}
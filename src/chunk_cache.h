@@ -0,0 +1,87 @@
+// chunk_cache.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+#ifndef CHUNK_CACHE_5755e20507d94c7d84fd0dbd0a2b3312
+#define CHUNK_CACHE_5755e20507d94c7d84fd0dbd0a2b3312
+#include <stdbool.h>
+#include <stdint.h>
+#include "task.h"
+#define CHUNK_CACHE_SEED UINT64_C(0x9e3779b97f4a7c15)
+
+/** Represents an entry of the cache index. An empty slot has no input. The
+ *  secondary hash is computed with an independent seed and is checked on every
+ *  hit, so a stale entry is only returned if both 64-bit hashes and the size
+ *  collide. */
+struct ChunkCacheSlot
+{
+    uint64_t hash;
+    uint64_t secondaryHash;
+    uint64_t offset;
+    uint32_t inputSize;
+    uint32_t outputSize;
+};
+
+/** Represents a persistent cache that maps the hash of a chunk to its encoded
+ *  bytes. The previous cache file is memory-mapped and only read; a new cache
+ *  file replaces it once encoding is complete. */
+struct ChunkCache
+{
+    char* path;
+    unsigned char width;
+    size_t capacity;
+    struct ChunkCacheSlot* slots;
+    unsigned char* data;
+    unsigned char* map;
+    size_t mapSize;
+};
+
+/** */
+typedef struct ChunkCache* ChunkCache;
+
+/**
+ * Opens the cache. A missing, corrupt or incompatible cache file is treated
+ * as empty.
+ * 
+ * @param instance
+ * @param path the path of the cache file.
+ * @param width the width of a symbol, in bytes.
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool chunk_cache(ChunkCache instance, char* path, unsigned char width);
+
+/**
+ * Finds the encoded bytes of a chunk.
+ * 
+ * @param instance
+ * @param hash the hash of the chunk.
+ * @param secondaryHash the hash of the chunk, seeded with `CHUNK_CACHE_SEED`.
+ * @param inputSize the size of the chunk.
+ * @param outputSize when this method returns, contains the size of the
+ *                   encoded bytes, if found.
+ * @return The encoded bytes, or `NULL` if the chunk is not in the cache.
+ */
+unsigned char* chunk_cache_find(
+    ChunkCache instance,
+    uint64_t hash,
+    uint64_t secondaryHash,
+    off_t inputSize,
+    off_t* outputSize);
+
+/**
+ * Replaces the cache file with the chunks of the given tasks.
+ * 
+ * @param instance
+ * @param items the completed tasks.
+ * @param count the number of tasks.
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool chunk_cache_save(ChunkCache instance, struct Task items[], size_t count);
+
+/**
+ * 
+ * @param instance
+ */
+void finalize_chunk_cache(ChunkCache instance);
+
+#endif
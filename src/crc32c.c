@@ -0,0 +1,145 @@
+// crc32c.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://github.com/madler/zlib/blob/v1.3.1/crc32.c
+//  - https://www.intel.com/content/dam/www/public/us/en/documents/white-papers/fast-crc-computation-generic-polynomials-pclmulqdq-paper.pdf
+
+#include <string.h>
+#include "crc32c.h"
+#define CRC32C_POLYNOMIAL 0x82f63b78
+#define CRC32C_SLICES 8
+
+static uint32_t crc32cTable[CRC32C_SLICES][256];
+
+void crc32c_initialize(void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t value = i;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            value = (value >> 1) ^ (CRC32C_POLYNOMIAL & -(value & 1));
+        }
+
+        crc32cTable[0][i] = value;
+    }
+
+    for (int slice = 1; slice < CRC32C_SLICES; slice++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint32_t value = crc32cTable[slice - 1][i];
+
+            crc32cTable[slice][i] = (value >> 8) ^ crc32cTable[0][value & 0xff];
+        }
+    }
+}
+
+uint32_t crc32c(uint32_t checksum, const unsigned char buffer[], off_t size)
+{
+    uint32_t result = ~checksum;
+    off_t i = 0;
+
+    for (; i + CRC32C_SLICES <= size; i += CRC32C_SLICES)
+    {
+        const unsigned char* p = buffer + i;
+        uint32_t low = result ^ 
+            ((uint32_t)p[0] | (uint32_t)p[1] << 8 | 
+            (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+
+        result =
+            crc32cTable[7][low & 0xff] ^
+            crc32cTable[6][(low >> 8) & 0xff] ^
+            crc32cTable[5][(low >> 16) & 0xff] ^
+            crc32cTable[4][low >> 24] ^
+            crc32cTable[3][p[4]] ^
+            crc32cTable[2][p[5]] ^
+            crc32cTable[1][p[6]] ^
+            crc32cTable[0][p[7]];
+    }
+
+    for (; i < size; i++)
+    {
+        result = (result >> 8) ^ crc32cTable[0][(result ^ buffer[i]) & 0xff];
+    }
+
+    return ~result;
+}
+
+static uint32_t crc32c_multiply(const uint32_t matrix[], uint32_t vector)
+{
+    uint32_t result = 0;
+
+    for (int i = 0; vector; i++, vector >>= 1)
+    {
+        if (vector & 1)
+        {
+            result ^= matrix[i];
+        }
+    }
+
+    return result;
+}
+
+static void crc32c_compose(
+    uint32_t result[],
+    const uint32_t left[],
+    const uint32_t right[])
+{
+    uint32_t product[CRC32C_BITS];
+
+    for (int i = 0; i < CRC32C_BITS; i++)
+    {
+        product[i] = crc32c_multiply(left, right[i]);
+    }
+
+    memcpy(result, product, sizeof product);
+}
+
+void crc32c_shift(uint32_t result[CRC32C_BITS], off_t size)
+{
+    uint32_t power[CRC32C_BITS];
+
+    power[0] = CRC32C_POLYNOMIAL;
+
+    for (int i = 1; i < CRC32C_BITS; i++)
+    {
+        power[i] = (uint32_t)1 << (i - 1);
+    }
+
+    for (int i = 0; i < CRC32C_BITS; i++)
+    {
+        result[i] = (uint32_t)1 << i;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        crc32c_compose(power, power, power);
+    }
+
+    for (; size; size >>= 1)
+    {
+        if (size & 1)
+        {
+            crc32c_compose(result, power, result);
+        }
+
+        crc32c_compose(power, power, power);
+    }
+}
+
+uint32_t crc32c_combine(
+    uint32_t first,
+    uint32_t second,
+    const uint32_t shift[CRC32C_BITS])
+{
+    return crc32c_multiply(shift, first) ^ second;
+}
+
+uint32_t crc32c_zeros(uint32_t checksum, const uint32_t shift[CRC32C_BITS])
+{
+    return ~crc32c_multiply(shift, ~checksum);
+}
@@ -0,0 +1,59 @@
+// crc32c.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://en.wikipedia.org/wiki/Cyclic_redundancy_check
+//  - https://www.rfc-editor.org/rfc/rfc3720#appendix-B.4
+
+#ifndef CRC32C_f541ccc1729442648b0292cc3979e15a
+#define CRC32C_f541ccc1729442648b0292cc3979e15a
+#include <sys/types.h>
+#include <stdint.h>
+#define CRC32C_BITS 32
+
+/** Initializes the lookup tables. Must be called before any other function. */
+void crc32c_initialize(void);
+
+/**
+ * Updates a CRC-32C (Castagnoli) checksum with the given bytes.
+ * 
+ * @param checksum the checksum of the preceding bytes, or 0.
+ * @param buffer
+ * @param size
+ * @return The checksum of the preceding bytes followed by the buffer.
+ */
+uint32_t crc32c(uint32_t checksum, const unsigned char buffer[], off_t size);
+
+/**
+ * Computes the operator that advances a checksum past the given number of
+ * bytes. The operator can be reused for any number of combinations.
+ * 
+ * @param result when this method returns, contains the operator.
+ * @param size the number of bytes to advance.
+ */
+void crc32c_shift(uint32_t result[CRC32C_BITS], off_t size);
+
+/**
+ * Combines the checksums of two consecutive byte sequences.
+ * 
+ * @param first the checksum of the first sequence.
+ * @param second the checksum of the second sequence.
+ * @param shift the operator for the size of the second sequence.
+ * @return The checksum of the concatenated sequences.
+ */
+uint32_t crc32c_combine(
+    uint32_t first,
+    uint32_t second,
+    const uint32_t shift[CRC32C_BITS]);
+
+/**
+ * Updates a checksum with a sequence of zero bytes without reading them.
+ * 
+ * @param checksum the checksum of the preceding bytes, or 0.
+ * @param shift the operator for the number of zero bytes.
+ * @return The checksum of the preceding bytes followed by the zero bytes.
+ */
+uint32_t crc32c_zeros(uint32_t checksum, const uint32_t shift[CRC32C_BITS]);
+
+#endif
@@ -0,0 +1,280 @@
+// direct.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://www.man7.org/linux/man-pages/man2/open.2.html
+//  - https://www.man7.org/linux/man-pages/man2/fcntl.2.html
+//  - https://www.man7.org/linux/man-pages/man3/fopencookie.3.html
+//  - https://www.man7.org/linux/man-pages/man3/posix_memalign.3.html
+
+// O_DIRECT and fopencookie in <direct.c>: _GNU_SOURCE
+
+#define _GNU_SOURCE
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "direct.h"
+
+/** Represents the state of a direct writer. The buffer is the aligned buffer
+ *  of the stream itself. */
+struct DirectWriter
+{
+    int descriptor;
+    int flags;
+    bool direct;
+    unsigned char* buffer;
+};
+
+static bool direct_disable(int descriptor)
+{
+    int flags = fcntl(descriptor, F_GETFL);
+
+    if (flags == -1)
+    {
+        return false;
+    }
+
+    return fcntl(descriptor, F_SETFL, flags & ~O_DIRECT) != -1;
+}
+
+bool direct_file(DirectFile instance, char* path)
+{
+    instance->direct = true;
+    instance->descriptor = open(path, O_RDONLY | O_DIRECT);
+
+    if (instance->descriptor == -1 && errno == EINVAL)
+    {
+        instance->direct = false;
+        instance->descriptor = open(path, O_RDONLY);
+    }
+
+    return instance->descriptor != -1;
+}
+
+off_t direct_file_read(DirectFile instance, unsigned char buffer[], off_t size)
+{
+    off_t result = 0;
+
+    while (result < size)
+    {
+        ssize_t count = read(
+            instance->descriptor,
+            buffer + result,
+            size - result);
+
+        if (count == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        // Direct reads need aligned offsets, which a short read may break.
+
+        if (count == -1 && errno == EINVAL && instance->direct)
+        {
+            if (!direct_disable(instance->descriptor))
+            {
+                return -1;
+            }
+
+            instance->direct = false;
+
+            continue;
+        }
+
+        if (count == -1)
+        {
+            return -1;
+        }
+
+        if (!count)
+        {
+            break;
+        }
+
+        result += count;
+    }
+
+    return result;
+}
+
+void finalize_direct_file(DirectFile instance)
+{
+    close(instance->descriptor);
+
+    instance->descriptor = -1;
+}
+
+unsigned char* direct_allocate(size_t size)
+{
+    void* result;
+    int ex = posix_memalign(&result, DIRECT_ALIGNMENT, size);
+
+    if (ex)
+    {
+        errno = ex;
+
+        return NULL;
+    }
+
+    return result;
+}
+
+static bool direct_writer_disable(struct DirectWriter* writer)
+{
+    writer->direct = false;
+
+    return fcntl(writer->descriptor, F_SETFL, writer->flags & ~O_DIRECT) != -1;
+}
+
+static bool direct_writer_restore(struct DirectWriter* writer)
+{
+    return fcntl(writer->descriptor, F_SETFL, writer->flags) != -1;
+}
+
+static ssize_t direct_writer_write(void* cookie, const char* data, size_t size)
+{
+    struct DirectWriter* writer = cookie;
+    size_t offset = 0;
+
+    // The stream hands over its whole aligned buffer each time it fills up.
+    // Anything else, normally only the final partial buffer, cannot be
+    // written directly.
+
+    if (writer->direct &&
+        ((const unsigned char*)data != writer->buffer ||
+            size % DIRECT_ALIGNMENT) &&
+        !direct_writer_disable(writer))
+    {
+        return -1;
+    }
+
+    while (offset < size)
+    {
+        ssize_t count = write(writer->descriptor, data + offset, size - offset);
+
+        if (count == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        // Direct writes also need an aligned file offset, which the initial
+        // position of the descriptor or a short write may break.
+
+        if (count == -1 && errno == EINVAL && writer->direct)
+        {
+            if (!direct_writer_disable(writer))
+            {
+                return -1;
+            }
+
+            continue;
+        }
+
+        if (count == -1)
+        {
+            return -1;
+        }
+
+        offset += count;
+    }
+
+    return size;
+}
+
+static int direct_writer_close(void* cookie)
+{
+    struct DirectWriter* writer = cookie;
+
+    // The stream has already written its final partial buffer. The descriptor
+    // is shared with the caller, so its flags are restored even if that write
+    // failed.
+
+    bool result = direct_writer_restore(writer);
+
+    free(writer->buffer);
+    free(writer);
+
+    return result ? 0 : EOF;
+}
+
+FILE* direct_writer(int descriptor)
+{
+    struct DirectWriter* writer = malloc(sizeof * writer);
+
+    if (!writer)
+    {
+        return NULL;
+    }
+
+    unsigned char* buffer = direct_allocate(DIRECT_WRITER_SIZE);
+
+    if (!buffer)
+    {
+        free(writer);
+
+        return NULL;
+    }
+
+    cookie_io_functions_t functions =
+    {
+        .write = direct_writer_write,
+        .close = direct_writer_close
+    };
+
+    struct stat status;
+
+    writer->descriptor = descriptor;
+    writer->flags = fcntl(descriptor, F_GETFL);
+    writer->direct = false;
+    writer->buffer = buffer;
+
+    // Only regular files are written directly: on a pipe, O_DIRECT switches
+    // the reader to packet mode instead.
+
+    if (writer->flags != -1 &&
+        fstat(descriptor, &status) != -1 &&
+        S_ISREG(status.st_mode))
+    {
+        writer->direct = fcntl(
+            descriptor,
+            F_SETFL,
+            writer->flags | O_DIRECT) != -1;
+    }
+
+    FILE* result = fopencookie(writer, "w", functions);
+
+    if (!result)
+    {
+        int ex = errno;
+
+        if (writer->direct)
+        {
+            direct_writer_restore(writer);
+        }
+
+        errno = ex;
+
+        free(buffer);
+        free(writer);
+
+        return NULL;
+    }
+
+    // Records and task bodies are copied once, straight into the aligned
+    // buffer, which is written without a bounce copy whenever it is full.
+
+    if (setvbuf(result, (char*)buffer, _IOFBF, DIRECT_WRITER_SIZE))
+    {
+        fclose(result);
+
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    return result;
+}
@@ -0,0 +1,73 @@
+// direct.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+#ifndef DIRECT_336821ed9c504bf48023243101c062ec
+#define DIRECT_336821ed9c504bf48023243101c062ec
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdio.h>
+#define DIRECT_ALIGNMENT 4096
+#define DIRECT_WRITER_SIZE (1 << 20)
+
+/** Represents a file read without the page cache. Direct I/O is dropped, and
+ *  the file is read through the page cache, if the file system rejects it. */
+struct DirectFile
+{
+    int descriptor;
+    bool direct;
+};
+
+/** */
+typedef struct DirectFile* DirectFile;
+
+/**
+ * Opens a file for direct reading.
+ * 
+ * @param instance
+ * @param path
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool direct_file(DirectFile instance, char* path);
+
+/**
+ * Reads from the current position until the buffer is full or the end of the
+ * file is reached.
+ * 
+ * @param instance
+ * @param buffer a buffer aligned to `DIRECT_ALIGNMENT`.
+ * @param size a multiple of `DIRECT_ALIGNMENT`.
+ * @return The number of bytes read, or -1 if an error occurs.
+ */
+off_t direct_file_read(DirectFile instance, unsigned char buffer[], off_t size);
+
+/**
+ * 
+ * @param instance
+ */
+void finalize_direct_file(DirectFile instance);
+
+/**
+ * Allocates a buffer aligned to `DIRECT_ALIGNMENT`. The buffer is released
+ * with `free`.
+ * 
+ * @param size
+ * @return The buffer, or `NULL` if an error occurs.
+ */
+unsigned char* direct_allocate(size_t size);
+
+/**
+ * Creates a stream that writes to the given descriptor without the page cache.
+ * The stream buffers output in an aligned buffer, which it writes whenever it
+ * is full. The final partial buffer, or any write that is not a whole aligned
+ * buffer, is written after direct I/O is turned off. A descriptor
+ * that is not a regular file is written through the page cache. Closing the
+ * stream restores the original file status flags of the descriptor but does
+ * not close it.
+ * 
+ * @param descriptor
+ * @return The stream, or `NULL` if an error occurs.
+ */
+FILE* direct_writer(int descriptor);
+
+#endif
@@ -4,57 +4,261 @@
 
 // References:
 //  - https://www.man7.org/linux/man-pages/man3/fwrite.3p.html
+//  - https://gcc.gnu.org/onlinedocs/gcc/Other-Builtins.html
+//  - https://graphics.stanford.edu/~seander/bithacks.html
 
 #include <assert.h>
 #include <limits.h>
 #include <string.h>
 #include <stdio.h>
 #include "encoder.h"
+#include "encoder_kernel.h"
+#define ENCODER_ZEROS_BUFFER_SIZE 1024
 
-bool encoder_flush(Encoder value)
+/** Represents an in-memory sink. */
+struct EncoderBuffer
 {
-    bool result = fwrite(&value, sizeof value, 1, stdout) == 1;
+    unsigned char* items;
+    off_t size;
+};
 
-    assert(result);
+/** Scans the input one symbol at a time. */
+static inline off_t encoder_scan_scalar(
+    const unsigned char input[],
+    off_t width,
+    off_t limit)
+{
+    off_t result = 1;
+
+    while (result < limit && !memcmp(input + result * width, input, width))
+    {
+        result++;
+    }
 
     return result;
 }
 
-bool encoder_next_encode(Encoder* instance, MappedFile input)
+/** Scans the input one machine word at a time. */
+static inline off_t encoder_scan_word(
+    const unsigned char input[],
+    off_t width,
+    off_t limit)
 {
-    Encoder clone = *instance;
+    uint64_t pattern;
 
-    for (off_t i = 0; i < input.size; i++)
+    if (width == 1)
+    {
+        pattern = input[0] * UINT64_C(0x0101010101010101);
+    }
+    else
     {
-        unsigned char current = input.buffer[i];
+        unsigned char bytes[sizeof pattern];
 
-        if (!clone.count)
+        for (off_t i = 0; i < (off_t)sizeof bytes; i += width)
         {
-            clone.previous = current;
-            clone.count = 1;
-
-            continue;
+            memcpy(bytes + i, input, width);
         }
 
-        if (current == clone.previous && clone.count < UCHAR_MAX)
+        memcpy(&pattern, bytes, sizeof pattern);
+    }
+
+    off_t size = limit * width;
+    off_t result = 0;
+
+    for (; result + (off_t)sizeof pattern <= size; result += sizeof pattern)
+    {
+        uint64_t word;
+
+        memcpy(&word, input + result, sizeof word);
+
+        uint64_t difference = word ^ pattern;
+
+        if (difference)
         {
-            clone.count++;
+            result += __builtin_ctzll(difference) / CHAR_BIT;
 
-            continue;
+            return result / width;
         }
-        
-        if (!encoder_flush(clone))
+    }
+
+    while (result < size && !memcmp(input + result, input, width))
+    {
+        result += width;
+    }
+
+    return result / width;
+}
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ENCODER_SCAN encoder_scan_word
+#else
+#define ENCODER_SCAN encoder_scan_scalar
+#endif
+
+static inline bool encoder_buffer_emit(void* sink, Encoder value, off_t width)
+{
+    struct EncoderBuffer* buffer = sink;
+
+    memcpy(buffer->items + buffer->size, &value.previous, width);
+
+    buffer->items[buffer->size + width] = value.count;
+    buffer->size += width + 1;
+
+    return true;
+}
+
+static inline bool encoder_stream_emit(void* sink, Encoder value, off_t width)
+{
+    unsigned char record[ENCODER_MAX_WIDTH + 1];
+
+    memcpy(record, &value.previous, width);
+
+    record[width] = value.count;
+
+    bool result = fwrite(record, width + 1, 1, sink) == 1;
+
+    assert(result);
+
+    return result;
+}
+
+/** Instantiates the kernel for one sink and one symbol width. */
+#define ENCODER_INSTANTIATE(sink, width) \
+    ENCODER_KERNEL( \
+        encoder_kernel_##sink##_##width, \
+        width, \
+        ENCODER_SCAN, \
+        encoder_##sink##_emit)
+
+ENCODER_INSTANTIATE(buffer, 1)
+ENCODER_INSTANTIATE(buffer, 2)
+ENCODER_INSTANTIATE(buffer, 4)
+ENCODER_INSTANTIATE(buffer, 8)
+ENCODER_INSTANTIATE(stream, 1)
+ENCODER_INSTANTIATE(stream, 2)
+ENCODER_INSTANTIATE(stream, 4)
+ENCODER_INSTANTIATE(stream, 8)
+
+static bool encoder_kernel_buffer(
+    Encoder* instance,
+    const unsigned char input[],
+    off_t inputSize,
+    struct EncoderBuffer* sink)
+{
+    switch (instance->width)
+    {
+    case 1: return encoder_kernel_buffer_1(instance, input, inputSize, sink);
+    case 2: return encoder_kernel_buffer_2(instance, input, inputSize, sink);
+    case 4: return encoder_kernel_buffer_4(instance, input, inputSize, sink);
+    case 8: return encoder_kernel_buffer_8(instance, input, inputSize, sink);
+    }
+
+    assert(false);
+
+    return false;
+}
+
+static bool encoder_kernel_stream(
+    Encoder* instance,
+    const unsigned char input[],
+    off_t inputSize,
+    FILE* sink)
+{
+    switch (instance->width)
+    {
+    case 1: return encoder_kernel_stream_1(instance, input, inputSize, sink);
+    case 2: return encoder_kernel_stream_2(instance, input, inputSize, sink);
+    case 4: return encoder_kernel_stream_4(instance, input, inputSize, sink);
+    case 8: return encoder_kernel_stream_8(instance, input, inputSize, sink);
+    }
+
+    assert(false);
+
+    return false;
+}
+
+void encoder(Encoder* instance, unsigned char width)
+{
+    memset(instance, 0, sizeof * instance);
+
+    instance->width = width;
+}
+
+off_t encoder_record_size(Encoder value)
+{
+    return value.width + 1;
+}
+
+void encoder_read(Encoder* instance, const unsigned char record[])
+{
+    instance->previous = 0;
+
+    memcpy(&instance->previous, record, instance->width);
+
+    instance->count = record[instance->width];
+}
+
+bool encoder_flush(Encoder value, FILE* output)
+{
+    return encoder_stream_emit(output, value, value.width);
+}
+
+bool encoder_next_encode(
+    Encoder* instance,
+    MappedFile input,
+    FILE* output)
+{
+    unsigned char* buffer = input.buffer;
+    off_t size = input.size;
+    off_t width = instance->width;
+
+    if (instance->pendingSize)
+    {
+        off_t missing = width - instance->pendingSize;
+
+        if (missing > size)
+        {
+            missing = size;
+        }
+
+        memcpy(instance->pending + instance->pendingSize, buffer, missing);
+
+        instance->pendingSize += missing;
+        buffer += missing;
+        size -= missing;
+
+        if (instance->pendingSize < width)
         {
-            *instance = clone;
+            return true;
+        }
 
+        unsigned char symbol[ENCODER_MAX_WIDTH];
+
+        memcpy(symbol, instance->pending, width);
+
+        instance->pendingSize = 0;
+
+        if (!encoder_kernel_stream(instance, symbol, width, output))
+        {
             return false;
         }
+    }
 
-        clone.count = 1;
-        clone.previous = current;
+    off_t remainder = size % width;
+
+    if (!encoder_kernel_stream(
+        instance,
+        buffer,
+        size - remainder,
+        output))
+    {
+        return false;
     }
 
-    *instance = clone;
+    memcpy(instance->pending, buffer + size - remainder, remainder);
+
+    instance->pendingSize = remainder;
 
     return true;
 }
@@ -64,54 +268,134 @@ off_t encoder_encode(
     Encoder* instance,
     unsigned char input[],
     off_t inputSize)
+{
+    struct EncoderBuffer buffer =
+    {
+        .items = output,
+        .size = 0
+    };
+
+    encoder_kernel_buffer(instance, input, inputSize, &buffer);
+
+    if (instance->count)
+    {
+        encoder_buffer_emit(&buffer, *instance, instance->width);
+    }
+
+    return buffer.size;
+}
+
+static bool encoder_next_zero_symbols(
+    Encoder* instance,
+    off_t count,
+    FILE* output)
 {
     Encoder clone = *instance;
-    off_t outputSize = 0;
 
-    for (off_t i = 0; i < inputSize; i++)
+    if (!count)
     {
-        unsigned char current = input[i];
+        return true;
+    }
 
-        if (!clone.count)
+    if (clone.count && clone.previous)
+    {
+        if (!encoder_flush(clone, output))
         {
-            clone.previous = current;
-            clone.count = 1;
+            return false;
+        }
+
+        clone.count = 0;
+    }
+
+    off_t total = clone.count + count;
+    off_t runs = (total - 1) / UCHAR_MAX;
 
-            continue;
+    clone.previous = 0;
+    clone.count = total - runs * UCHAR_MAX;
+
+    off_t recordSize = encoder_record_size(clone);
+    unsigned char buffer[ENCODER_ZEROS_BUFFER_SIZE * (ENCODER_MAX_WIDTH + 1)];
+    off_t bufferSize = runs;
+
+    if (bufferSize > ENCODER_ZEROS_BUFFER_SIZE)
+    {
+        bufferSize = ENCODER_ZEROS_BUFFER_SIZE;
+    }
+
+    memset(buffer, 0, bufferSize * recordSize);
+
+    for (off_t i = 0; i < bufferSize; i++)
+    {
+        buffer[i * recordSize + clone.width] = UCHAR_MAX;
+    }
+
+    while (runs)
+    {
+        size_t size = runs < bufferSize ? runs : bufferSize;
+        bool ok = fwrite(buffer, recordSize, size, output) == size;
+
+        assert(ok);
+
+        if (!ok)
+        {
+            return false;
         }
 
-        if (current == clone.previous && clone.count < UCHAR_MAX)
+        runs -= size;
+    }
+
+    *instance = clone;
+
+    return true;
+}
+
+bool encoder_next_zeros(Encoder* instance, off_t size, FILE* output)
+{
+    unsigned char zeros[ENCODER_MAX_WIDTH] = { 0 };
+    MappedFile input =
+    {
+        .buffer = zeros,
+        .size = 0
+    };
+
+    if (instance->pendingSize)
+    {
+        input.size = instance->width - instance->pendingSize;
+
+        if (input.size > size)
         {
-            clone.count++;
+            input.size = size;
+        }
 
-            continue;
+        if (!encoder_next_encode(instance, input, output))
+        {
+            return false;
         }
-        
-        memcpy(output + outputSize, &clone, sizeof clone);
-        
-        outputSize += sizeof clone;
-        clone.count = 1;
-        clone.previous = current;
+
+        size -= input.size;
     }
 
-    if (clone.count)
+    if (!encoder_next_zero_symbols(instance, size / instance->width, output))
     {
-        memcpy(output + outputSize, &clone, sizeof clone);
-
-        outputSize += sizeof clone;
+        return false;
     }
 
-    *instance = clone;
+    input.size = size % instance->width;
 
-    return outputSize;
+    return encoder_next_encode(instance, input, output);
 }
 
-bool encoder_end_encode(Encoder instance)
+bool encoder_end_encode(Encoder instance, FILE* output)
 {
-    if (!instance.count)
+    if (instance.count && !encoder_flush(instance, output))
     {
-        return true;
+        return false;
     }
 
-    return encoder_flush(instance);
+    size_t size = instance.pendingSize;
+    bool result = fwrite(instance.pending, 1, size, output) == size;
+
+    assert(result);
+
+    return result;
 }
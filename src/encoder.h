@@ -5,47 +5,97 @@
 // References:
 //  - https://en.wikipedia.org/wiki/Run-length_encoding
 
+#ifndef ENCODER_e4ea5f35450b4153836d325ac10224c1
+#define ENCODER_e4ea5f35450b4153836d325ac10224c1
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "mapped_file.h"
+#define ENCODER_MAX_WIDTH 8
 
-/** */
+/** Represents the state of an encoder. A run is written as a record of `width`
+ *  bytes holding the symbol followed by one byte holding the count. Input that
+ *  does not yet form a whole symbol is kept as pending. */
 struct Encoder
 {
-    unsigned char previous;
+    uint64_t previous;
     unsigned char count;
+    unsigned char width;
+    unsigned char pendingSize;
+    unsigned char pending[ENCODER_MAX_WIDTH];
 };
 
 /** */
 typedef struct Encoder Encoder;
 
+/**
+ * Initializes an encoder.
+ * 
+ * @param instance
+ * @param width the width of a symbol, in bytes: 1, 2, 4 or 8.
+ */
+void encoder(Encoder* instance, unsigned char width);
+
+/**
+ * Gets the size of a record written by the encoder.
+ * 
+ * @param value
+ * @return The size of the symbol and its count, in bytes.
+ */
+off_t encoder_record_size(Encoder value);
+
+/**
+ * Reads a run from a record.
+ * 
+ * @param instance the encoder whose run to overwrite. Its width determines the
+ *                 size of the record.
+ * @param record
+ */
+void encoder_read(Encoder* instance, const unsigned char record[]);
+
 /**
  * 
  * @param value
+ * @param output
  * @return 
  */
-bool encoder_flush(Encoder value);
+bool encoder_flush(Encoder value, FILE* output);
 
 /**
  * 
  * @param value
  * @param input
+ * @param output
  * @return 
  */
-bool encoder_next_encode(Encoder* value, MappedFile input);
+bool encoder_next_encode(Encoder* value, MappedFile input, FILE* output);
 
 /**
+ * Continues encoding with a sequence of zero bytes without reading them from
+ * memory. Completed runs are written to the output, and the last run is kept
+ * in the encoder.
  * 
  * @param value
+ * @param size the number of zero bytes.
+ * @param output
  * @return 
  */
-bool encoder_end_encode(Encoder value);
+bool encoder_next_zeros(Encoder* value, off_t size, FILE* output);
+
+/**
+ * 
+ * @param value
+ * @param output
+ * @return 
+ */
+bool encoder_end_encode(Encoder value, FILE* output);
 
 /**
  * 
  * @param output
  * @param instance
  * @param input
- * @param inputSize
+ * @param inputSize the size of the input, a multiple of the symbol width.
  * @return 
  */
 off_t encoder_encode(
@@ -53,3 +103,5 @@ off_t encoder_encode(
     Encoder* instance,
     unsigned char input[],
     off_t inputSize);
+
+#endif
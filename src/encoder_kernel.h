@@ -0,0 +1,86 @@
+// encoder_kernel.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://en.wikipedia.org/wiki/Run-length_encoding
+//  - https://gcc.gnu.org/onlinedocs/cpp/Macros.html
+
+#ifndef ENCODER_KERNEL_8d0f3c2e6a5b4f1e9c7d2b4a6e8f0a1c
+#define ENCODER_KERNEL_8d0f3c2e6a5b4f1e9c7d2b4a6e8f0a1c
+#include <limits.h>
+#include <string.h>
+#include "encoder.h"
+
+// ENCODER_KERNEL(name, width, scan, emit) instantiates one kernel, a static
+// inline function with the following signature, specialized on the symbol
+// width, the scan routine and the sink:
+//
+//     bool name(
+//         Encoder* instance,
+//         const unsigned char input[],
+//         off_t inputSize,
+//         void* sink);
+//
+// The kernel encodes the input, a multiple of the symbol width, and emits
+// each completed run to the sink with `emit(sink, value, width)`, which
+// evaluates to `true` if successful. The last run is kept in the encoder so
+// that it can be continued by subsequent input. The scan has the signature of
+// `encoder_scan_scalar`.
+//
+// A count is one byte, so a run is at most UCHAR_MAX symbols long. Most runs
+// in typical input are short, so a new symbol costs one compare; the scan only
+// starts once a second equal symbol shows that the run continues.
+
+#define ENCODER_KERNEL(name, width, scan, emit) \
+    static inline bool name( \
+        Encoder* instance, \
+        const unsigned char input[], \
+        off_t inputSize, \
+        void* sink) \
+    { \
+        Encoder clone = *instance; \
+        off_t i = 0; \
+        \
+        while (i < inputSize) \
+        { \
+            uint64_t current = 0; \
+            \
+            memcpy(&current, input + i, width); \
+            \
+            if (clone.count && current == clone.previous && \
+                clone.count < UCHAR_MAX) \
+            { \
+                off_t limit = (inputSize - i) / width; \
+                \
+                if (limit > UCHAR_MAX - clone.count) \
+                { \
+                    limit = UCHAR_MAX - clone.count; \
+                } \
+                \
+                off_t length = scan(input + i, width, limit); \
+                \
+                clone.count += length; \
+                i += length * width; \
+                \
+                continue; \
+            } \
+            \
+            if (clone.count && !emit(sink, clone, width)) \
+            { \
+                *instance = clone; \
+                \
+                return false; \
+            } \
+            \
+            clone.previous = current; \
+            clone.count = 1; \
+            i += width; \
+        } \
+        \
+        *instance = clone; \
+        \
+        return true; \
+    }
+
+#endif
@@ -0,0 +1,45 @@
+// frame.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+#ifndef FRAME_279fb13468db44a5907a49f5b312a644
+#define FRAME_279fb13468db44a5907a49f5b312a644
+#define FRAME_MAGIC "NYUF"
+#define FRAME_VERSION 1
+
+// The framed format begins with the magic bytes, the version and the symbol
+// width, one byte each after the magic. It is followed by one frame per task,
+// in order, so that a frame is identified by its zero-based index. If input
+// checksums are enabled, a checksum frame precedes the end frame. All
+// integers are little-endian.
+
+/** Specifies the type of a frame. The type is the first byte of a frame. */
+enum FrameType
+{
+    /** A 32-bit size followed by a self-contained encoded block. */
+    FRAME_TYPE_LITERAL = 0,
+
+    /** The 64-bit index of an earlier frame with an identical block. */
+    FRAME_TYPE_REFERENCE,
+
+    /** The 64-bit size of a run of zero bytes. */
+    FRAME_TYPE_HOLE,
+
+    /** An 8-bit size followed by the trailing partial symbol, if any. */
+    FRAME_TYPE_END,
+
+    /** A 32-bit size followed by a Huffman-coded block: the 32-bit number of
+     *  records, the 32-bit size of the coded symbols, the coded symbols and
+     *  the coded counts. */
+    FRAME_TYPE_HUFFMAN,
+
+    /** The 64-bit number of earlier frames followed by the 32-bit CRC-32C of
+     *  the decoded block of each earlier frame, in order, so that blocks can
+     *  be verified independently. */
+    FRAME_TYPE_CHECKSUMS
+};
+
+/** */
+typedef enum FrameType FrameType;
+
+#endif
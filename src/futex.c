@@ -0,0 +1,62 @@
+// futex.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://www.man7.org/linux/man-pages/man2/futex.2.html
+//  - https://www.man7.org/linux/man-pages/man2/syscall.2.html
+
+// syscall in <futex.c>: _DEFAULT_SOURCE
+
+#define _DEFAULT_SOURCE
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include "futex.h"
+
+bool futex_wait(int* address, int expected)
+{
+    long ex = syscall(
+        SYS_futex,
+        address,
+        FUTEX_WAIT_PRIVATE,
+        expected,
+        NULL,
+        NULL,
+        0);
+    bool result = ex != -1 || errno == EAGAIN || errno == EINTR;
+
+    assert(result);
+
+    return result;
+}
+
+bool futex_wake(int* address)
+{
+    long ex = syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    bool result = ex != -1;
+
+    assert(result);
+
+    return result;
+}
+
+bool futex_wake_all(int* address)
+{
+    long ex = syscall(
+        SYS_futex,
+        address,
+        FUTEX_WAKE_PRIVATE,
+        INT_MAX,
+        NULL,
+        NULL,
+        0);
+    bool result = ex != -1;
+
+    assert(result);
+
+    return result;
+}
@@ -0,0 +1,39 @@
+// futex.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://www.man7.org/linux/man-pages/man2/futex.2.html
+
+#ifndef FUTEX_06294a952c4b4140ab180874f23135c5
+#define FUTEX_06294a952c4b4140ab180874f23135c5
+#include <stdbool.h>
+
+/**
+ * Blocks the calling thread while the value at the given address is equal to
+ * the expected value. The thread may also return spuriously.
+ * 
+ * @param address the futex word.
+ * @param expected the value that the futex word must hold for the thread to
+ *                 block.
+ * @return `true` if the thread was woken or did not block; otherwise, `false`.
+ */
+bool futex_wait(int* address, int expected);
+
+/**
+ * Wakes at most one thread blocked on the given address.
+ * 
+ * @param address the futex word.
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool futex_wake(int* address);
+
+/**
+ * Wakes all threads blocked on the given address.
+ * 
+ * @param address the futex word.
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool futex_wake_all(int* address);
+
+#endif
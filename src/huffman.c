@@ -0,0 +1,249 @@
+// huffman.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://en.wikipedia.org/wiki/Huffman_coding#Compression
+//  - https://www.rfc-editor.org/rfc/rfc1951#section-3.2.2
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "huffman.h"
+
+/** Represents a node of a Huffman tree. Leaves come first, followed by the
+ *  internal nodes in the order in which they are created. */
+struct HuffmanNode
+{
+    uint64_t frequency;
+    int parent;
+    int symbol;
+};
+
+static int huffman_compare(const void* left, const void* right)
+{
+    const struct HuffmanNode* a = left;
+    const struct HuffmanNode* b = right;
+
+    if (a->frequency != b->frequency)
+    {
+        return a->frequency < b->frequency ? -1 : 1;
+    }
+
+    return a->symbol - b->symbol;
+}
+
+static int huffman_pop(
+    struct HuffmanNode nodes[],
+    int* leaf,
+    int leafCount,
+    int* internal,
+    int internalCount)
+{
+    if (*leaf < leafCount &&
+        (*internal >= internalCount ||
+            nodes[*leaf].frequency <= nodes[*internal].frequency))
+    {
+        return (*leaf)++;
+    }
+
+    return (*internal)++;
+}
+
+static int huffman_lengths(
+    unsigned char lengths[HUFFMAN_SYMBOLS],
+    const uint64_t frequencies[HUFFMAN_SYMBOLS])
+{
+    struct HuffmanNode nodes[2 * HUFFMAN_SYMBOLS];
+    unsigned char depths[2 * HUFFMAN_SYMBOLS];
+    int leafCount = 0;
+
+    memset(lengths, 0, HUFFMAN_SYMBOLS);
+
+    for (int symbol = 0; symbol < HUFFMAN_SYMBOLS; symbol++)
+    {
+        if (frequencies[symbol])
+        {
+            nodes[leafCount].frequency = frequencies[symbol];
+            nodes[leafCount].symbol = symbol;
+            leafCount++;
+        }
+    }
+
+    if (!leafCount)
+    {
+        return 0;
+    }
+
+    if (leafCount == 1)
+    {
+        lengths[nodes[0].symbol] = 1;
+
+        return 1;
+    }
+
+    qsort(nodes, leafCount, sizeof * nodes, huffman_compare);
+
+    // Two-queue construction: the leaves are sorted, and internal nodes are
+    // created in nondecreasing order of frequency.
+
+    int leaf = 0;
+    int internal = leafCount;
+    int count = leafCount;
+
+    while (count < 2 * leafCount - 1)
+    {
+        int left = huffman_pop(nodes, &leaf, leafCount, &internal, count);
+        int right = huffman_pop(nodes, &leaf, leafCount, &internal, count);
+
+        nodes[count].frequency = nodes[left].frequency +
+            nodes[right].frequency;
+        nodes[left].parent = count;
+        nodes[right].parent = count;
+        count++;
+    }
+
+    int result = 0;
+
+    depths[count - 1] = 0;
+
+    for (int i = count - 2; i >= 0; i--)
+    {
+        depths[i] = depths[nodes[i].parent] + 1;
+    }
+
+    for (int i = 0; i < leafCount; i++)
+    {
+        lengths[nodes[i].symbol] = depths[i];
+
+        if (depths[i] > result)
+        {
+            result = depths[i];
+        }
+    }
+
+    return result;
+}
+
+static void huffman_codes(
+    uint16_t codes[HUFFMAN_SYMBOLS],
+    const unsigned char lengths[HUFFMAN_SYMBOLS])
+{
+    uint16_t counts[HUFFMAN_MAX_LENGTH + 1] = { 0 };
+    uint16_t next[HUFFMAN_MAX_LENGTH + 1];
+    uint16_t code = 0;
+
+    for (int symbol = 0; symbol < HUFFMAN_SYMBOLS; symbol++)
+    {
+        counts[lengths[symbol]]++;
+    }
+
+    counts[0] = 0;
+
+    for (int length = 1; length <= HUFFMAN_MAX_LENGTH; length++)
+    {
+        code = (code + counts[length - 1]) << 1;
+        next[length] = code;
+    }
+
+    for (int symbol = 0; symbol < HUFFMAN_SYMBOLS; symbol++)
+    {
+        if (lengths[symbol])
+        {
+            codes[symbol] = next[lengths[symbol]];
+            next[lengths[symbol]]++;
+        }
+    }
+}
+
+off_t huffman_encode(
+    unsigned char output[],
+    off_t capacity,
+    HuffmanStream stream)
+{
+    uint64_t frequencies[HUFFMAN_SYMBOLS] = { 0 };
+    unsigned char lengths[HUFFMAN_SYMBOLS];
+    uint16_t codes[HUFFMAN_SYMBOLS];
+
+    if (capacity < HUFFMAN_TABLE_SIZE)
+    {
+        return 0;
+    }
+
+    for (off_t i = 0; i < stream.count; i++)
+    {
+        const unsigned char* field = stream.records +
+            i * stream.recordSize +
+            stream.offset;
+
+        for (off_t j = 0; j < stream.width; j++)
+        {
+            frequencies[field[j]]++;
+        }
+    }
+
+    // Halving the frequencies flattens the tree until every code fits. Each
+    // nonzero frequency stays nonzero so that every symbol keeps a code.
+
+    while (huffman_lengths(lengths, frequencies) > HUFFMAN_MAX_LENGTH)
+    {
+        for (int symbol = 0; symbol < HUFFMAN_SYMBOLS; symbol++)
+        {
+            if (frequencies[symbol])
+            {
+                frequencies[symbol] = (frequencies[symbol] >> 1) | 1;
+            }
+        }
+    }
+
+    huffman_codes(codes, lengths);
+
+    for (int i = 0; i < HUFFMAN_TABLE_SIZE; i++)
+    {
+        output[i] = lengths[2 * i] | (lengths[2 * i + 1] << 4);
+    }
+
+    off_t size = HUFFMAN_TABLE_SIZE;
+    uint32_t bits = 0;
+    int bitCount = 0;
+
+    for (off_t i = 0; i < stream.count; i++)
+    {
+        const unsigned char* field = stream.records +
+            i * stream.recordSize +
+            stream.offset;
+
+        for (off_t j = 0; j < stream.width; j++)
+        {
+            unsigned char symbol = field[j];
+
+            bits = (bits << lengths[symbol]) | codes[symbol];
+            bitCount += lengths[symbol];
+
+            while (bitCount >= 8)
+            {
+                if (size == capacity)
+                {
+                    return 0;
+                }
+
+                bitCount -= 8;
+                output[size] = bits >> bitCount;
+                size++;
+            }
+        }
+    }
+
+    if (bitCount)
+    {
+        if (size == capacity)
+        {
+            return 0;
+        }
+
+        output[size] = bits << (8 - bitCount);
+        size++;
+    }
+
+    return size;
+}
@@ -0,0 +1,46 @@
+// huffman.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://en.wikipedia.org/wiki/Canonical_Huffman_code
+//  - https://www.rfc-editor.org/rfc/rfc1951#section-3.2.2
+
+#ifndef HUFFMAN_b53406a957d74cfc9070d6889113ec46
+#define HUFFMAN_b53406a957d74cfc9070d6889113ec46
+#include <sys/types.h>
+#define HUFFMAN_SYMBOLS 256
+#define HUFFMAN_MAX_LENGTH 15
+#define HUFFMAN_TABLE_SIZE (HUFFMAN_SYMBOLS / 2)
+
+/** Represents a strided sequence of bytes: the given number of bytes at the
+ *  given offset within each record. */
+struct HuffmanStream
+{
+    const unsigned char* records;
+    off_t count;
+    off_t recordSize;
+    off_t offset;
+    off_t width;
+};
+
+/** */
+typedef struct HuffmanStream HuffmanStream;
+
+/**
+ * Encodes a stream with a canonical Huffman code built for that stream. The
+ * output is a table of code lengths, two 4-bit lengths per byte with the even
+ * symbol in the low bits, followed by the codes, most significant bit first,
+ * padded with zero bits to a whole byte.
+ * 
+ * @param output the output buffer.
+ * @param capacity the size of the output buffer.
+ * @param stream the bytes to encode.
+ * @return The number of bytes written, or 0 if the output would not fit.
+ */
+off_t huffman_encode(
+    unsigned char output[],
+    off_t capacity,
+    HuffmanStream stream);
+
+#endif
@@ -3,48 +3,178 @@
 // Licensed under the MIT license.
 
 // References:
+//  - https://www.man7.org/linux/man-pages/man3/fopen.3p.html
+//  - https://www.man7.org/linux/man-pages/man3/fork.3p.html
 //  - https://www.man7.org/linux/man-pages/man3/fwrite.3p.html
 //  - https://www.man7.org/linux/man-pages/man3/getopt.3.html
+//  - https://www.man7.org/linux/man-pages/man3/getopt_long.3.html
 //  - https://www.man7.org/linux/man-pages/man3/perror.3.html
 //  - https://www.man7.org/linux/man-pages/man3/sprintf.3p.html
 //  - https://www.man7.org/linux/man-pages/man3/strtol.3.html
+//  - https://www.man7.org/linux/man-pages/man3/waitpid.3p.html
 
 //  - https://www.man7.org/linux/man-pages/man3/pthread_cond_signal.3p.html
 //  - https://www.man7.org/linux/man-pages/man3/pthread_mutex_lock.3p.html
 
+#include <sys/wait.h>
+#include <getopt.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include "chunk_cache.h"
+#include "direct.h"
 #include "encoder.h"
 #include "error.h"
+#include "frame.h"
+#include "processor.h"
 #include "thread_pool.h"
+#define MAIN_DIRECT_SIZE (TASK_SIZE * 2048)
+#define MAIN_OPTION_DIRECT 256
 
 static void main_print_usage(FILE* output, char* args[])
 {
     fprintf(output, "Usage: %s [OPTION]... FILE...\n", args[0]);
 }
 
-static bool main_encode_sequential(MappedFileCollection mappedFiles)
+static bool main_write_checksum(char* path, uint32_t checksum)
 {
-    Encoder encoder = { 0 };
+    FILE* output = fopen(path, "w");
+
+    if (!output)
+    {
+        return false;
+    }
+
+    bool result = fprintf(output, "%08" PRIx32 "\n", checksum) > 0;
+
+    return fclose(output) != EOF && result;
+}
+
+static bool main_encode_sequential_hole(
+    Encoder* encoder,
+    TaskOptions options,
+    uint32_t* checksum,
+    off_t size)
+{
+    if (!size)
+    {
+        return true;
+    }
+
+    if (options.checksum)
+    {
+        uint32_t shift[CRC32C_BITS];
+
+        crc32c_shift(shift, size);
+
+        *checksum = crc32c_zeros(*checksum, shift);
+    }
+
+    return encoder_next_zeros(encoder, size, stdout);
+}
+
+static bool main_encode_sequential_extent(
+    Encoder* encoder,
+    TaskOptions options,
+    uint32_t* checksum,
+    MappedFile extent)
+{
+    if (!options.checksum)
+    {
+        return encoder_next_encode(encoder, extent, stdout);
+    }
+
+    for (off_t offset = 0; offset < extent.size; offset += TASK_SIZE)
+    {
+        MappedFile block =
+        {
+            .buffer = extent.buffer + offset,
+            .size = extent.size - offset
+        };
+
+        if (block.size > TASK_SIZE)
+        {
+            block.size = TASK_SIZE;
+        }
+
+        *checksum = crc32c(*checksum, block.buffer, block.size);
+
+        if (!encoder_next_encode(encoder, block, stdout))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool main_encode_sequential(
+    MappedFileCollection mappedFiles,
+    TaskOptions options,
+    uint32_t* checksum)
+{
+    Encoder value;
+
+    encoder(&value, options.width);
+
+    *checksum = 0;
 
     for (int i = 0; i < mappedFiles->count; i++)
     {
-        if (!encoder_next_encode(&encoder, mappedFiles->items[i]))
+        MappedFile mappedFile = mappedFiles->items[i];
+        off_t position = 0;
+
+        for (int j = 0; j < mappedFile.extentCount; j++)
+        {
+            struct MappedExtent extent = mappedFile.extents[j];
+            MappedFile data =
+            {
+                .buffer = mappedFile.buffer + extent.offset,
+                .size = extent.size
+            };
+
+            if (!main_encode_sequential_hole(
+                &value,
+                options,
+                checksum,
+                extent.offset - position))
+            {
+                return false;
+            }
+
+            if (!main_encode_sequential_extent(
+                &value,
+                options,
+                checksum,
+                data))
+            {
+                return false;
+            }
+
+            position = extent.offset + extent.size;
+        }
+
+        if (!main_encode_sequential_hole(
+            &value,
+            options,
+            checksum,
+            mappedFile.size - position))
         {
             return false;
         }
     }
 
-    return encoder_end_encode(encoder);
+    return encoder_end_encode(value, stdout);
 }
 
 static void* main_consume(void* arg)
 {
     ThreadPool pool = (ThreadPool)arg;
+    int worker = thread_pool_join(pool);
     Task current;
     int* result = calloc(1, sizeof * result);
 
@@ -55,289 +185,872 @@ static void* main_consume(void* arg)
         return NULL;
     }
 
-    while (thread_pool_dequeue(pool, &current))
+    while (thread_pool_dequeue(pool, worker, &current))
     {
-        off_t outputSize = task_execute(current);
-
-        error_thread_ok(pthread_mutex_lock(&pool->mutex));
+        task_execute(current, pool->options);
 
-        current->outputSize = outputSize;
-        pool->resultsCount++;
-
-        if (pool->resultId == current->id)
+        if (!task_complete(pool->states + current->id))
         {
-            pool->resultId++;
+            *result = errno;
 
-            error_thread_ok(pthread_cond_signal(&pool->consumer));
+            return result;
         }
-
-        error_thread_ok(pthread_mutex_unlock(&pool->mutex));
     }
 
     return result;
 }
 
-static bool main_next_flush(ThreadPool pool)
+static void main_next_checksum(ThreadPool pool, Task current)
 {
-    if (pool->flushId == 0 && pool->resultId > 0)
+    if (!pool->options.checksum)
     {
-        Task current = pool->items;
+        return;
+    }
 
-        if (current->outputSize >= 2)
-        {
-            unsigned char* output = current->output;
-            size_t size = current->outputSize - 2;
+    if (current->inputSize == TASK_SIZE)
+    {
+        pool->checksum = crc32c_combine(
+            pool->checksum,
+            current->checksum,
+            pool->shift);
 
-            bool ok = fwrite(output, sizeof * output, size, stdout) == size;
+        return;
+    }
 
-            assert(ok);
+    uint32_t shift[CRC32C_BITS];
 
-            if (!ok)
-            {
-                return false;
-            }
-        }
+    crc32c_shift(shift, current->inputSize);
+
+    pool->checksum = crc32c_combine(pool->checksum, current->checksum, shift);
+}
+
+static bool main_next_flush(ThreadPool pool)
+{
+    Task current = pool->items + pool->flushId;
+    Encoder first = current->first;
 
-        pool->flushId++;
+    main_next_checksum(pool, current);
+
+    pool->flushId++;
+
+    if (!current->input)
+    {
+        return encoder_next_zeros(
+            &pool->carry,
+            current->inputSize,
+            pool->output);
     }
 
-    for (; pool->flushId < pool->resultId; pool->flushId++)
+    if (!first.count)
     {
-        Task current = pool->items + pool->flushId;
-        Task previous = current - 1;
-        size_t size = current->outputSize;
-        off_t previousSize = previous->outputSize;
+        return true;
+    }
 
-        if (size < 2 || previousSize < 2)
+    if (!pool->carry.count)
+    {
+        pool->carry = first;
+    }
+    else if (first.previous == pool->carry.previous &&
+        first.count + pool->carry.count <= UCHAR_MAX)
+    {
+        pool->carry.count += first.count;
+    }
+    else
+    {
+        if (!encoder_flush(pool->carry, pool->output))
         {
-            continue;
+            return false;
         }
 
-        unsigned char* output = current->output;
-        unsigned char symbol = output[0];
-        unsigned int count = output[1];
-        unsigned int previousCount = previous->output[previousSize - 1];
-        unsigned int previousSymbol = previous->output[previousSize - 2];
+        pool->carry = first;
+    }
 
-        if (symbol == previousSymbol && count + previousCount <= UCHAR_MAX)
-        {
-            output[1] += previousCount;
-        }
-        else
-        {
-            Encoder encoder =
-            {
-                .previous = previousSymbol,
-                .count = previousCount
-            };
+    if (!current->last.count)
+    {
+        return true;
+    }
 
-            if (!encoder_flush(encoder))
-            {
-                return false;
-            }
-        }
+    if (!encoder_flush(pool->carry, pool->output))
+    {
+        return false;
+    }
 
-        if (size <= 2)
-        {
-            continue;
-        }
+    pool->carry = current->last;
 
-        size -= 2;
+    unsigned char* body = current->body;
+    size_t size = current->bodySize;
+    bool result = fwrite(body, sizeof * body, size, pool->output) == size;
 
-        bool ok = fwrite(output, sizeof * output, size, stdout) == size;
+    assert(result);
 
-        assert(ok);
+    return result;
+}
 
-        if (!ok)
-        {
-            return false;
-        }
+static void main_end_checksum(ThreadPool pool)
+{
+    if (!pool->options.checksum || !pool->tailSize)
+    {
+        return;
     }
 
-    return true;
+    uint32_t shift[CRC32C_BITS];
+    uint32_t tail = crc32c(0, pool->tail, pool->tailSize);
+
+    crc32c_shift(shift, pool->tailSize);
+
+    pool->checksum = crc32c_combine(pool->checksum, tail, shift);
 }
 
 static bool main_end_flush(ThreadPool pool)
 {
-    if (!pool->flushId)
+    main_end_checksum(pool);
+
+    pool->carry.pendingSize = pool->tailSize;
+
+    memcpy(pool->carry.pending, pool->tail, pool->tailSize);
+
+    return encoder_end_encode(pool->carry, pool->output);
+}
+
+static bool main_write_frame(
+    ThreadPool pool,
+    FrameType type,
+    uint64_t value,
+    int size)
+{
+    unsigned char buffer[1 + sizeof value];
+
+    buffer[0] = type;
+
+    for (int i = 0; i < size; i++)
+    {
+        buffer[1 + i] = value >> (8 * i);
+    }
+
+    size_t length = size + 1;
+    bool result = fwrite(
+        buffer,
+        sizeof * buffer,
+        length,
+        pool->output) == length;
+
+    assert(result);
+
+    return result;
+}
+
+static bool main_begin_frames(ThreadPool pool)
+{
+    unsigned char header[] =
     {
-        return true;
+        FRAME_MAGIC[0],
+        FRAME_MAGIC[1],
+        FRAME_MAGIC[2],
+        FRAME_MAGIC[3],
+        FRAME_VERSION,
+        pool->options.width
+    };
+
+    return fwrite(header, sizeof header, 1, pool->output) == 1;
+}
+
+static bool main_next_frame(ThreadPool pool)
+{
+    Task current = pool->items + pool->flushId;
+
+    main_next_checksum(pool, current);
+
+    pool->flushId++;
+
+    if (!current->input)
+    {
+        return main_write_frame(
+            pool,
+            FRAME_TYPE_HOLE,
+            current->inputSize,
+            8);
+    }
+
+    if (current->reference != current->id)
+    {
+        return main_write_frame(
+            pool,
+            FRAME_TYPE_REFERENCE,
+            current->reference,
+            8);
+    }
+
+    FrameType type = FRAME_TYPE_LITERAL;
+    unsigned char* output = current->output;
+    size_t size = current->outputSize;
+
+    if (current->codedSize)
+    {
+        type = FRAME_TYPE_HUFFMAN;
+        output = current->coded;
+        size = current->codedSize;
     }
 
-    Task previous = pool->items + pool->flushId - 1;
-    unsigned char* output = previous->output;
-    off_t size = previous->outputSize;
+    if (!main_write_frame(pool, type, size, 4))
+    {
+        return false;
+    }
 
-    bool result = fwrite(output + size - 2, sizeof * output, 2, stdout) == 2;
+    bool result = fwrite(
+        output,
+        sizeof * output,
+        size,
+        pool->output) == size;
 
     assert(result);
 
     return result;
 }
 
-static bool main_produce(
-    ThreadPool pool,
-    MappedFileCollection mappedFiles,
-    unsigned long jobs)
+static bool main_write_checksums(ThreadPool pool)
 {
-    error_ok(pthread_mutex_lock(&pool->mutex));
-
-    size_t id = 0;
+    if (!main_write_frame(pool, FRAME_TYPE_CHECKSUMS, pool->count, 8))
+    {
+        return false;
+    }
 
-    for (int i = 0; i < mappedFiles->count; i++)
+    for (size_t i = 0; i < pool->count; i++)
     {
-        MappedFile mappedFile = mappedFiles->items[i];
-        off_t offsets = mappedFile.size / TASK_SIZE;
-        off_t remainder = mappedFile.size % TASK_SIZE;
-        struct Task* items = pool->items;
+        uint32_t checksum = pool->items[i].checksum;
+        unsigned char buffer[sizeof checksum];
 
-        for (off_t offset = 0; offset < offsets; offset++)
+        for (size_t j = 0; j < sizeof buffer; j++)
         {
-            items[id].id = id;
-            items[id].input = mappedFile.buffer + offset * TASK_SIZE;
-            items[id].inputSize = TASK_SIZE;
-            id++;
+            buffer[j] = checksum >> (8 * j);
         }
 
-        if (remainder)
+        if (fwrite(buffer, sizeof buffer, 1, pool->output) != 1)
         {
-            items[id].id = id;
-            items[id].input = mappedFile.buffer + offsets * TASK_SIZE;
-            items[id].inputSize = remainder;
-            id++;
+            return false;
         }
     }
 
-    pool->count = id;
+    return true;
+}
+
+static bool main_end_frames(ThreadPool pool)
+{
+    unsigned char* tail = pool->tail;
+    size_t size = pool->tailSize;
 
-    for (unsigned long job = 0; job < jobs; job++)
+    main_end_checksum(pool);
+
+    if (pool->options.checksum && !main_write_checksums(pool))
+    {
+        return false;
+    }
+
+    if (!main_write_frame(pool, FRAME_TYPE_END, size, 1))
+    {
+        return false;
+    }
+
+    return fwrite(tail, sizeof * tail, size, pool->output) == size;
+}
+
+static bool main_begin_flush(ThreadPool pool)
+{
+    if (pool->options.framed)
     {
-        error_ok(pthread_cond_signal(&pool->producer));
+        return main_begin_frames(pool);
     }
 
-    error_ok(pthread_mutex_unlock(&pool->mutex));
+    return true;
+}
+
+static bool main_flush_until(ThreadPool pool, size_t end)
+{
+    bool framed = pool->options.framed;
 
-    for (;;)
+    while (pool->flushId < end)
     {
-        error_ok(pthread_mutex_lock(&pool->mutex));
-        error_ok(pthread_cond_wait(&pool->consumer, &pool->mutex));
-        
-        if (!main_next_flush(pool))
+        int* state = pool->states + pool->flushId;
+        bool stalled = !task_is_completed(state);
+
+        if (!task_wait(state))
         {
             return false;
         }
 
-        if (pool->resultsCount >= pool->count)
+        if (framed ? !main_next_frame(pool) : !main_next_flush(pool))
         {
-            if (!main_end_flush(pool))
-            {
-                return false;
-            }
+            return false;
+        }
+
+        if (!thread_pool_adapt(pool, stalled))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool main_finish_flush(ThreadPool pool)
+{
+    if (pool->options.framed)
+    {
+        return main_end_frames(pool);
+    }
+
+    return main_end_flush(pool);
+}
 
-            error_ok(pthread_mutex_unlock(&pool->mutex));
+static unsigned long main_start(
+    ThreadPool pool,
+    pthread_t consumers[],
+    unsigned long jobs)
+{
+    for (unsigned long job = 0; job < jobs; job++)
+    {
+        int ex = pthread_create(consumers + job, NULL, main_consume, pool);
+
+        assert(!ex);
+
+        if (ex)
+        {
+            errno = ex;
 
-            return true;
+            return job;
         }
+    }
 
-        error_ok(pthread_mutex_unlock(&pool->mutex));
+    return jobs;
+}
+
+static bool main_stop(
+    ThreadPool pool,
+    pthread_t consumers[],
+    unsigned long started,
+    bool result)
+{
+    int ex = result ? 0 : errno;
+
+    if (!thread_pool_close(pool) && !ex)
+    {
+        ex = errno;
     }
+
+    for (unsigned long job = 0; job < started; job++)
+    {
+        void* value;
+        int joined = pthread_join(consumers[job], &value);
+
+        assert(!joined && value && !*(int*)value);
+
+        if (joined)
+        {
+            ex = ex ? ex : joined;
+
+            continue;
+        }
+
+        if (!value)
+        {
+            ex = ex ? ex : ENOMEM;
+
+            continue;
+        }
+
+        ex = ex ? ex : *(int*)value;
+
+        free(value);
+    }
+
+    errno = ex;
+
+    return !ex;
+}
+
+static bool main_run(ThreadPool pool, unsigned long jobs)
+{
+    pthread_t* consumers = malloc(jobs * sizeof * consumers);
+
+    assert(consumers);
+
+    if (!consumers)
+    {
+        return false;
+    }
+
+    unsigned long started = main_start(pool, consumers, jobs);
+    bool result = started == jobs && main_flush_until(pool, pool->count);
+
+    result = main_stop(pool, consumers, started, result);
+
+    free(consumers);
+
+    return result;
 }
 
 static bool main_encode_parallel(
     MappedFileCollection mappedFiles,
-    unsigned long jobs)
+    unsigned long jobs,
+    bool adaptive,
+    TaskOptions options,
+    uint32_t* checksum)
 {
     struct ThreadPool pool;
 
-    if (!thread_pool(&pool, mappedFiles))
+    if (!thread_pool(&pool, mappedFiles, options, false))
     {
         return false;
     }
 
-    int ex = 0;
+    pool.adaptive = adaptive;
+    pool.maximum = jobs;
+    pool.active = jobs;
+
+    bool result = main_begin_flush(&pool) &&
+        main_run(&pool, jobs) &&
+        main_finish_flush(&pool);
+
+    if (result && options.cache)
+    {
+        result = chunk_cache_save(options.cache, pool.items, pool.count);
+    }
+
+    if (result)
+    {
+        *checksum = pool.checksum;
+    }
+
+    int ex = errno;
+
+    finalize_thread_pool(&pool);
+
+    errno = ex;
+
+    return result;
+}
+
+static bool main_encode_batch(
+    ThreadPool pool,
+    unsigned char batch[],
+    off_t size)
+{
+    // The previous batch is flushed before the pool is refilled. The partial
+    // symbol it left over is placed immediately before this batch so that it
+    // is encoded with it.
+
+    off_t tailSize = pool->tailSize;
+    struct MappedExtent extent =
+    {
+        .size = tailSize + size
+    };
+    struct MappedFile mappedFile =
+    {
+        .size = extent.size,
+        .buffer = batch - tailSize,
+        .extentCount = 1,
+        .extents = &extent
+    };
+    struct MappedFileCollection mappedFiles =
+    {
+        .count = 1,
+        .items = &mappedFile
+    };
+
+    if (!main_flush_until(pool, pool->count))
+    {
+        return false;
+    }
+
+    memcpy(batch - tailSize, pool->tail, tailSize);
+
+    return thread_pool_refill(pool, &mappedFiles);
+}
+
+static bool main_encode_direct_file(
+    ThreadPool pool,
+    unsigned char* batches[],
+    char* path)
+{
+    struct DirectFile file;
+
+    if (!direct_file(&file, path))
+    {
+        return false;
+    }
+
+    bool result = true;
+
+    // Each batch is read into the buffer that is not being encoded, so that
+    // reading the next batch overlaps encoding the previous one.
+
+    while (result)
+    {
+        unsigned char* batch = batches[0];
+        off_t size = direct_file_read(&file, batch, MAIN_DIRECT_SIZE);
+
+        if (size <= 0)
+        {
+            result = size == 0;
+
+            break;
+        }
+
+        result = main_encode_batch(pool, batch, size);
+        batches[0] = batches[1];
+        batches[1] = batch;
+    }
+
+    int ex = errno;
+
+    finalize_direct_file(&file);
+
+    errno = ex;
+
+    return result;
+}
+
+static bool main_encode_direct_files(
+    ThreadPool pool,
+    unsigned long jobs,
+    char* paths[],
+    int count,
+    unsigned char* batches[])
+{
     pthread_t* consumers = malloc(jobs * sizeof * consumers);
 
     assert(consumers);
 
     if (!consumers)
     {
-        goto encode_parallel_thread_pool;
+        return false;
     }
 
-    for (unsigned long job = 0; job < jobs; job++)
+    // The workers are started once and wait for each batch in turn.
+
+    unsigned long started = main_start(pool, consumers, jobs);
+    bool result = started == jobs;
+
+    for (int i = 0; result && i < count; i++)
     {
-        ex = pthread_create(consumers + job, NULL, main_consume, &pool);
+        result = main_encode_direct_file(pool, batches, paths[i]);
+    }
 
-        assert(!ex);
+    result = result && main_flush_until(pool, pool->count);
+    result = main_stop(pool, consumers, started, result);
 
-        if (ex)
+    free(consumers);
+
+    return result && main_finish_flush(pool);
+}
+
+static bool main_encode_direct(
+    char* paths[],
+    int count,
+    unsigned long jobs,
+    bool adaptive,
+    TaskOptions options,
+    uint32_t* checksum)
+{
+    struct MappedFileCollection empty =
+    {
+        .count = 0,
+        .items = NULL
+    };
+    struct ThreadPool pool;
+
+    if (!thread_pool(&pool, &empty, options, false))
+    {
+        return false;
+    }
+
+    // Each of the two batch buffers is preceded by room for a partial symbol.
+
+    off_t stride = DIRECT_ALIGNMENT + MAIN_DIRECT_SIZE;
+    unsigned char* buffer = direct_allocate(2 * stride);
+
+    if (!buffer)
+    {
+        int ex = errno;
+
+        finalize_thread_pool(&pool);
+
+        errno = ex;
+
+        return false;
+    }
+
+    fflush(stdout);
+
+    FILE* output = direct_writer(STDOUT_FILENO);
+    bool result = output != NULL;
+
+    if (result)
+    {
+        unsigned char* batches[] =
         {
-            errno = ex;
+            buffer + DIRECT_ALIGNMENT,
+            buffer + stride + DIRECT_ALIGNMENT
+        };
+
+        pool.output = output;
+        pool.adaptive = adaptive;
+        pool.maximum = jobs;
+        pool.active = jobs;
+        pool.open = true;
+        result = main_encode_direct_files(
+            &pool,
+            jobs,
+            paths,
+            count,
+            batches);
+
+        if (fclose(output) == EOF && result)
+        {
+            result = false;
+        }
+    }
+
+    if (result)
+    {
+        *checksum = pool.checksum;
+    }
+
+    int ex = errno;
+
+    free(buffer);
+    finalize_thread_pool(&pool);
+
+    errno = ex;
+
+    return result;
+}
+
+static size_t main_shard_begin(ThreadPool pool, long shard, long shards)
+{
+    return pool->count * shard / shards;
+}
 
-            goto encode_parallel_consumers;
+static void main_run_shard(ThreadPool pool, long shard, long shards)
+{
+    size_t begin = main_shard_begin(pool, shard, shards);
+    size_t end = main_shard_begin(pool, shard + 1, shards);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        Task current = pool->items + i;
+
+        task_execute(current, pool->options);
+
+        if (!task_complete(pool->states + current->id))
+        {
+            _exit(errno);
         }
     }
 
-    if (!main_produce(&pool, mappedFiles, jobs))
+    _exit(EXIT_SUCCESS);
+}
+
+static bool main_wait_shard(pid_t child)
+{
+    int status;
+
+    if (waitpid(child, &status, 0) == -1)
     {
-        goto encode_parallel_consumers;
+        return false;
     }
 
-    for (unsigned long job = 0; job < jobs; job++)
+    if (WIFEXITED(status) && WEXITSTATUS(status))
     {
-        void* result;
+        errno = WEXITSTATUS(status);
 
-        ex = pthread_join(consumers[job], &result);
+        return false;
+    }
 
-        assert(!ex && result && !*(int*)result);
+    if (!WIFEXITED(status))
+    {
+        errno = ECHILD;
 
-        if (ex)
+        return false;
+    }
+
+    return true;
+}
+
+static bool main_encode_sharded(
+    MappedFileCollection mappedFiles,
+    long shards,
+    TaskOptions options,
+    uint32_t* checksum)
+{
+    struct ThreadPool pool;
+
+    if (!thread_pool(&pool, mappedFiles, options, true))
+    {
+        return false;
+    }
+
+    int ex = 0;
+    long started = 0;
+    long waited = 0;
+    pid_t* children = malloc(shards * sizeof * children);
+
+    assert(children);
+
+    if (!children)
+    {
+        ex = errno;
+
+        goto encode_sharded_thread_pool;
+    }
+
+    fflush(stdout);
+
+    for (; started < shards; started++)
+    {
+        pid_t child = fork();
+
+        if (child == -1)
         {
-            errno = ex;
+            ex = errno;
 
-            goto encode_parallel_consumers;
+            goto encode_sharded_children;
         }
 
-        if (!result)
+        if (!child)
         {
-            goto encode_parallel_consumers;
+            main_run_shard(&pool, started, shards);
         }
 
-        if (*(int*)result)
+        children[started] = child;
+    }
+
+    // Shards complete in any order, but their outputs are stitched in order
+    // with the same seam rules as the threaded writer.
+
+    if (!main_begin_flush(&pool))
+    {
+        ex = errno;
+
+        goto encode_sharded_children;
+    }
+
+    for (long shard = 0; shard < shards; shard++)
+    {
+        waited++;
+
+        if (!main_wait_shard(children[shard]))
+        {
+            ex = errno;
+
+            goto encode_sharded_children;
+        }
+
+        size_t end = main_shard_begin(&pool, shard + 1, shards);
+
+        if (!main_flush_until(&pool, end))
         {
-            errno = *(int*)result;
+            ex = errno;
 
-            free(result);
-            
-            goto encode_parallel_consumers;
+            goto encode_sharded_children;
         }
-        
-        free(result);
     }
 
-encode_parallel_consumers:
-    free(consumers);
-encode_parallel_thread_pool:
+    if (!main_finish_flush(&pool))
+    {
+        ex = errno;
+
+        goto encode_sharded_children;
+    }
+
+    if (options.cache &&
+        !chunk_cache_save(options.cache, pool.items, pool.count))
+    {
+        ex = errno;
+
+        goto encode_sharded_children;
+    }
+
+    *checksum = pool.checksum;
+
+encode_sharded_children:
+    for (; waited < started; waited++)
+    {
+        waitpid(children[waited], NULL, 0);
+    }
+
+    free(children);
+encode_sharded_thread_pool:
     finalize_thread_pool(&pool);
 
+    errno = ex;
+
     return !ex;
 }
 
 int main(int count, char* args[])
 {
+    static const struct option longOptions[] =
+    {
+        { "direct", no_argument, NULL, MAIN_OPTION_DIRECT },
+        { NULL, 0, NULL, 0 }
+    };
     int option;
     unsigned long jobs = 1;
-
-    while ((option = getopt(count, args, "hj:")) != -1)
+    bool threaded = false;
+    bool adaptive = false;
+    long shards = 0;
+    unsigned long width = 1;
+    char* checksumPath = NULL;
+    char* cachePath = NULL;
+    bool framed = false;
+    bool entropy = false;
+    bool direct = false;
+
+    while ((option = getopt_long(
+        count,
+        args,
+        "C:c:FHhj:p:w:",
+        longOptions,
+        NULL)) != -1)
     {
         switch (option)
         {
+        case MAIN_OPTION_DIRECT:
+            direct = true;
+            break;
+
+        case 'C':
+            cachePath = optarg;
+            break;
+
+        case 'c':
+            checksumPath = optarg;
+            break;
+
+        case 'F':
+            framed = true;
+            break;
+
+        case 'H':
+            framed = true;
+            entropy = true;
+            break;
+
         case 'h':
             main_print_usage(stdout, args);
 
             return EXIT_SUCCESS;
 
         case 'j':
+            threaded = true;
+
+            if (!strcmp(optarg, "auto"))
+            {
+                adaptive = true;
+                jobs = processor_count();
+                break;
+            }
+
             errno = 0;
             jobs = strtoul(optarg, NULL, 10);
 
@@ -349,21 +1062,94 @@ int main(int count, char* args[])
             }
             break;
 
+        case 'p':
+            errno = 0;
+            shards = strtol(optarg, NULL, 10);
+
+            if (errno || shards < 1)
+            {
+                main_print_usage(stderr, args);
+
+                return EXIT_FAILURE;
+            }
+            break;
+
+        case 'w':
+            errno = 0;
+            width = strtoul(optarg, NULL, 10);
+
+            if (errno || 
+                width < 1 || 
+                width > ENCODER_MAX_WIDTH || 
+                (width & (width - 1)))
+            {
+                main_print_usage(stderr, args);
+
+                return EXIT_FAILURE;
+            }
+            break;
+
         default: return EXIT_FAILURE;
         }
     }
 
-    if (optind >= count)
+    // Each shard is a single-threaded process, so the number of shards is the
+    // degree of parallelism and a number of jobs cannot also be given.
+
+    if (optind >= count ||
+        (shards && threaded) ||
+        (direct && (shards || cachePath || framed)))
     {
         main_print_usage(stderr, args);
 
         return EXIT_FAILURE;
     }
 
-    struct MappedFileCollection mappedFiles;
+    bool result;
+    uint32_t checksum = 0;
+    struct ChunkCache cache;
     int fileCount = count - optind;
-    int ex = mapped_file_collection(&mappedFiles, args + optind, fileCount);
     char* app = args[0];
+    TaskOptions options =
+    {
+        .checksum = checksumPath != NULL,
+        .framed = framed,
+        .entropy = entropy,
+        .width = width
+    };
+
+    if (options.checksum)
+    {
+        crc32c_initialize();
+    }
+
+    if (direct)
+    {
+        result = main_encode_direct(
+            args + optind,
+            fileCount,
+            jobs,
+            adaptive,
+            options,
+            &checksum);
+
+        if (result && options.checksum)
+        {
+            result = main_write_checksum(checksumPath, checksum);
+        }
+
+        if (!result)
+        {
+            perror(app);
+
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    struct MappedFileCollection mappedFiles;
+    int ex = mapped_file_collection(&mappedFiles, args + optind, fileCount);
 
     if (ex == -1)
     {
@@ -381,19 +1167,49 @@ int main(int count, char* args[])
         return EXIT_FAILURE;
     }
 
-    bool result;
+    if (cachePath)
+    {
+        if (!chunk_cache(&cache, cachePath, width))
+        {
+            fprintf(stderr, "%s: %s: %s\n", app, cachePath, strerror(errno));
+            finalize_mapped_file_collection(&mappedFiles);
+
+            return EXIT_FAILURE;
+        }
+
+        options.cache = &cache;
+    }
 
-    if (jobs == 1)
+    if (shards)
     {
-        result = main_encode_sequential(&mappedFiles);
+        result = main_encode_sharded(&mappedFiles, shards, options, &checksum);
+    }
+    else if (jobs == 1 && !options.cache && !options.framed)
+    {
+        result = main_encode_sequential(&mappedFiles, options, &checksum);
     }
     else
     {
-        result = main_encode_parallel(&mappedFiles, jobs);
+        result = main_encode_parallel(
+            &mappedFiles,
+            jobs,
+            adaptive,
+            options,
+            &checksum);
+    }
+
+    if (options.cache)
+    {
+        finalize_chunk_cache(options.cache);
     }
 
     finalize_mapped_file_collection(&mappedFiles);
 
+    if (result && options.checksum)
+    {
+        result = main_write_checksum(checksumPath, checksum);
+    }
+
     if (!result)
     {
         perror(app);
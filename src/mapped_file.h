@@ -9,11 +9,20 @@
 // References:
 //  - https://www.man7.org/linux/man-pages/man3/off_t.3type.html
 
+/** Represents a range of a file that is backed by data, not a hole. */
+struct MappedExtent
+{
+    off_t offset;
+    off_t size;
+};
+
 /** */
 struct MappedFile
 {
     off_t size;
     unsigned char* buffer;
+    int extentCount;
+    struct MappedExtent* extents;
 };
 
 /** */
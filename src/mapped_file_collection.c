@@ -5,12 +5,17 @@
 // References:
 //  - https://man7.org/linux/man-pages/man2/close.2.html
 //  - https://www.man7.org/linux/man-pages/man3/fstat.3p.html
+//  - https://www.man7.org/linux/man-pages/man2/lseek.2.html
 //  - https://www.man7.org/linux/man-pages/man2/mmap.2.html
 //  - https://www.man7.org/linux/man-pages/man2/open.2.html
 //  - https://www.man7.org/linux/man-pages/man3/stat.3type.html
 
+// SEEK_DATA and SEEK_HOLE in <mapped_file_collection.c>: _GNU_SOURCE
+
+#define _GNU_SOURCE
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -20,12 +25,104 @@ static void mapped_file_collection_unmap(MappedFile items[], int count)
 {
     for (int i = 0; i < count; i++) 
     {
-        munmap(items[i].buffer, items[i].size);
+        if (items[i].size)
+        {
+            munmap(items[i].buffer, items[i].size);
+        }
+
+        free(items[i].extents);
     }
 
     free(items);
 }
 
+static bool mapped_file_collection_add_extent(
+    MappedFile* instance,
+    int* capacity,
+    off_t offset,
+    off_t size)
+{
+    if (instance->extentCount == *capacity)
+    {
+        int newCapacity = *capacity * 2;
+        struct MappedExtent* newExtents = realloc(
+            instance->extents,
+            newCapacity * sizeof * newExtents);
+
+        if (!newExtents)
+        {
+            return false;
+        }
+
+        instance->extents = newExtents;
+        *capacity = newCapacity;
+    }
+
+    instance->extents[instance->extentCount].offset = offset;
+    instance->extents[instance->extentCount].size = size;
+    instance->extentCount++;
+
+    return true;
+}
+
+static bool mapped_file_collection_extents(
+    MappedFile* instance,
+    int descriptor)
+{
+    int capacity = 4;
+
+    instance->extentCount = 0;
+    instance->extents = malloc(capacity * sizeof * instance->extents);
+
+    if (!instance->extents)
+    {
+        return false;
+    }
+
+    for (off_t offset = 0; offset < instance->size; )
+    {
+        off_t data = lseek(descriptor, offset, SEEK_DATA);
+
+        if (data == -1 && errno == ENXIO)
+        {
+            break;
+        }
+
+        off_t hole = -1;
+
+        if (data != -1)
+        {
+            hole = lseek(descriptor, data, SEEK_HOLE);
+        }
+
+        if (hole == -1)
+        {
+            // The file system cannot report holes: treat the remainder as data
+
+            data = offset;
+            hole = instance->size;
+        }
+
+        if (hole > instance->size)
+        {
+            hole = instance->size;
+        }
+
+        if (!mapped_file_collection_add_extent(
+            instance,
+            &capacity,
+            data,
+            hole - data))
+        {
+            return false;
+        }
+
+        offset = hole;
+    }
+
+    return true;
+}
+
 int mapped_file_collection(
     MappedFileCollection instance, 
     char* paths[], 
@@ -58,24 +155,37 @@ int mapped_file_collection(
             return i;
         }
 
-        unsigned char* buffer = mmap(
-            NULL,
-            status.st_size,
-            PROT_READ,
-            MAP_PRIVATE,
-            descriptor,
-            0);
+        unsigned char* buffer = NULL;
 
-        if (buffer == MAP_FAILED)
+        if (status.st_size)
         {
-            mapped_file_collection_unmap(items, i);
-
-            return i;
+            buffer = mmap(
+                NULL,
+                status.st_size,
+                PROT_READ,
+                MAP_PRIVATE,
+                descriptor,
+                0);
+
+            if (buffer == MAP_FAILED)
+            {
+                mapped_file_collection_unmap(items, i);
+
+                return i;
+            }
         }
 
         items[i].size = status.st_size;
         items[i].buffer = buffer;
 
+        if (!mapped_file_collection_extents(items + i, descriptor))
+        {
+            close(descriptor);
+            mapped_file_collection_unmap(items, i + 1);
+
+            return i;
+        }
+
         if (close(descriptor) == -1)
         {
             mapped_file_collection_unmap(items, i + 1);
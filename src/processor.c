@@ -0,0 +1,245 @@
+// processor.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://www.man7.org/linux/man-pages/man2/sched_getaffinity.2.html
+//  - https://www.man7.org/linux/man-pages/man3/sysconf.3.html
+//  - https://docs.kernel.org/admin-guide/cgroup-v2.html#cpu-interface-files
+//  - https://docs.kernel.org/scheduler/sched-bwc.html
+//  - https://www.man7.org/linux/man-pages/man7/cgroups.7.html
+
+// sched_getaffinity and CPU_COUNT in <processor.c>: _GNU_SOURCE
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "processor.h"
+#define PROCESSOR_CGROUP_ROOT "/sys/fs/cgroup"
+#define PROCESSOR_PATH_SIZE 4096
+
+static int processor_read(const char* path, long values[], int count)
+{
+    FILE* input = fopen(path, "r");
+
+    if (!input)
+    {
+        return 0;
+    }
+
+    int result = 0;
+
+    while (result < count && fscanf(input, "%ld", values + result) == 1)
+    {
+        result++;
+    }
+
+    fclose(input);
+
+    return result;
+}
+
+static long processor_limit(long quota, long period)
+{
+    if (quota > 0 && period > 0)
+    {
+        return (quota + period - 1) / period;
+    }
+
+    return 0;
+}
+
+static long processor_quota_at(const char* directory, bool unified)
+{
+    char path[PROCESSOR_PATH_SIZE];
+    long values[2];
+    int length;
+
+    // Version 2 stores "$MAX $PERIOD", where the maximum may be "max".
+    // Version 1 stores the quota and the period in separate files, and a
+    // negative quota means that there is no limit.
+
+    if (unified)
+    {
+        length = snprintf(path, sizeof path, "%s/cpu.max", directory);
+
+        if (length < 0 || (size_t)length >= sizeof path ||
+            processor_read(path, values, 2) != 2)
+        {
+            return 0;
+        }
+
+        return processor_limit(values[0], values[1]);
+    }
+
+    length = snprintf(path, sizeof path, "%s/cpu.cfs_quota_us", directory);
+
+    if (length < 0 || (size_t)length >= sizeof path ||
+        !processor_read(path, values, 1))
+    {
+        return 0;
+    }
+
+    length = snprintf(path, sizeof path, "%s/cpu.cfs_period_us", directory);
+
+    if (length < 0 || (size_t)length >= sizeof path ||
+        !processor_read(path, values + 1, 1))
+    {
+        return 0;
+    }
+
+    return processor_limit(values[0], values[1]);
+}
+
+static bool processor_cgroup_has_cpu(char* controllers)
+{
+    for (char* name = strtok(controllers, ","); name; name = strtok(NULL, ","))
+    {
+        if (!strcmp(name, "cpu"))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static size_t processor_cgroup(char directory[], bool* unified)
+{
+    char line[PROCESSOR_PATH_SIZE];
+    FILE* input = fopen("/proc/self/cgroup", "r");
+    size_t result = strlen(PROCESSOR_CGROUP_ROOT);
+
+    strcpy(directory, PROCESSOR_CGROUP_ROOT);
+
+    *unified = true;
+
+    if (!input)
+    {
+        return result;
+    }
+
+    // Each line is "$ID:$CONTROLLERS:$PATH". Version 2 has a single line with
+    // ID 0 and no controllers; version 1 has one line per hierarchy. A
+    // version 1 hierarchy with the cpu controller takes precedence.
+
+    while (fgets(line, sizeof line, input))
+    {
+        char* controllers = strchr(line, ':');
+        char* path = controllers ? strchr(controllers + 1, ':') : NULL;
+
+        if (!path)
+        {
+            continue;
+        }
+
+        *controllers = '\0';
+        *path = '\0';
+        controllers++;
+        path++;
+        path[strcspn(path, "\n")] = '\0';
+
+        if (!strcmp(path, "/"))
+        {
+            path[0] = '\0';
+        }
+
+        bool version2 = !strcmp(line, "0") && !controllers[0];
+        bool version1 = processor_cgroup_has_cpu(controllers);
+        const char* root = PROCESSOR_CGROUP_ROOT;
+
+        if (version1)
+        {
+            root = PROCESSOR_CGROUP_ROOT "/cpu";
+        }
+        else if (!version2)
+        {
+            continue;
+        }
+
+        int length = snprintf(
+            directory,
+            PROCESSOR_PATH_SIZE,
+            "%s%s",
+            root,
+            path);
+
+        if (length < 0 || length >= PROCESSOR_PATH_SIZE)
+        {
+            strcpy(directory, root);
+        }
+
+        *unified = !version1;
+        result = strlen(root);
+
+        if (version1)
+        {
+            break;
+        }
+    }
+
+    fclose(input);
+
+    return result;
+}
+
+static long processor_quota(void)
+{
+    char directory[PROCESSOR_PATH_SIZE];
+    bool unified;
+    long result = 0;
+
+    size_t rootLength = processor_cgroup(directory, &unified);
+
+    // The effective quota is the smallest quota of the group and of each of
+    // its ancestors up to the mount point.
+
+    for (;;)
+    {
+        long quota = processor_quota_at(directory, unified);
+
+        if (quota && (!result || quota < result))
+        {
+            result = quota;
+        }
+
+        char* separator = strrchr(directory + rootLength, '/');
+
+        if (!separator)
+        {
+            break;
+        }
+
+        *separator = '\0';
+    }
+
+    return result;
+}
+
+long processor_count(void)
+{
+    long result = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+
+    if (!sched_getaffinity(0, sizeof set, &set) && CPU_COUNT(&set) < result)
+    {
+        result = CPU_COUNT(&set);
+    }
+
+    long quota = processor_quota();
+
+    if (quota && quota < result)
+    {
+        result = quota;
+    }
+
+    if (result < 1)
+    {
+        result = 1;
+    }
+
+    return result;
+}
@@ -0,0 +1,17 @@
+// processor.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+#ifndef PROCESSOR_fbabc3b9292246f8bac9f8eb87a613f7
+#define PROCESSOR_fbabc3b9292246f8bac9f8eb87a613f7
+
+/**
+ * Counts the processors available to the calling process. The count is the
+ * smallest of the online processors, the processors in the affinity mask, and
+ * the CPU bandwidth quota of the control group, rounded up.
+ * 
+ * @return The number of available processors, at least 1.
+ */
+long processor_count(void);
+
+#endif
@@ -2,48 +2,257 @@
 // Copyright (c) 2024 Ishan Pranav
 // Licensed under the MIT license.
 
-#include <limits.h>
-#include <string.h>
+// References:
+//  - https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+//  - https://www.akkadia.org/drepper/futex.pdf
+
+#include <stddef.h>
+#include "block_table.h"
+#include "chunk_cache.h"
+#include "crc32c.h"
 #include "encoder.h"
+#include "futex.h"
+#include "huffman.h"
 #include "task.h"
+#include "xxhash64.h"
 
-off_t task_execute(Task instance)
+static void task_execute_hole(Task instance, TaskOptions options)
 {
-    off_t outputSize = 0;
-    Encoder encoder = { 0 };
+    instance->reference = instance->id;
+    instance->first.count = 0;
+    instance->last.count = 0;
+    instance->outputSize = 0;
+    instance->codedSize = 0;
+    instance->bodySize = 0;
 
-    for (off_t i = 0; i < instance->inputSize; i++)
+    if (options.checksum)
     {
-        unsigned char current = instance->input[i];
+        uint32_t shift[CRC32C_BITS];
 
-        if (!encoder.count)
-        {
-            encoder.previous = current;
-            encoder.count = 1;
+        crc32c_shift(shift, instance->inputSize);
 
-            continue;
-        }
+        instance->checksum = crc32c_zeros(0, shift);
+    }
+}
+
+static void task_write_uint32(unsigned char output[], uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        output[i] = value >> (8 * i);
+    }
+}
+
+static void task_execute_entropy(
+    Task instance,
+    const unsigned char output[],
+    off_t size,
+    off_t recordSize)
+{
+    // The coded form holds the number of records and the size of the coded
+    // symbols, followed by the coded symbols and the coded counts. Each part
+    // has its own table because symbols and counts are distributed very
+    // differently. The coded form is kept only if it is smaller.
+
+    unsigned char* coded = instance->coded;
+    off_t headerSize = 8;
+    off_t capacity = size - 1;
+    HuffmanStream stream =
+    {
+        .records = output,
+        .count = size / recordSize,
+        .recordSize = recordSize,
+        .width = recordSize - 1
+    };
+
+    instance->codedSize = 0;
+
+    if (capacity <= headerSize)
+    {
+        return;
+    }
+
+    off_t symbolSize = huffman_encode(
+        coded + headerSize,
+        capacity - headerSize,
+        stream);
+
+    if (!symbolSize)
+    {
+        return;
+    }
+
+    stream.offset = stream.width;
+    stream.width = 1;
+
+    off_t countSize = huffman_encode(
+        coded + headerSize + symbolSize,
+        capacity - headerSize - symbolSize,
+        stream);
+
+    if (!countSize)
+    {
+        return;
+    }
+
+    task_write_uint32(coded, stream.count);
+    task_write_uint32(coded + 4, symbolSize);
+
+    instance->codedSize = headerSize + symbolSize + countSize;
+}
+
+void task_execute(Task instance, TaskOptions options)
+{
+    if (!instance->input)
+    {
+        task_execute_hole(instance, options);
+
+        return;
+    }
+
+    if (options.checksum)
+    {
+        instance->checksum = crc32c(0, instance->input, instance->inputSize);
+    }
+
+    instance->reference = instance->id;
+
+    if (options.cache || options.blocks)
+    {
+        instance->hash = xxhash64(0, instance->input, instance->inputSize);
+    }
+
+    if (options.cache)
+    {
+        instance->secondaryHash = xxhash64(
+            CHUNK_CACHE_SEED,
+            instance->input,
+            instance->inputSize);
+    }
+
+    if (options.blocks)
+    {
+        instance->reference = block_table_add(options.blocks, instance);
 
-        if (current == encoder.previous && encoder.count < UCHAR_MAX)
+        if (instance->reference != instance->id)
         {
-            encoder.count++;
+            instance->first.count = 0;
+            instance->last.count = 0;
+            instance->outputSize = 0;
+            instance->codedSize = 0;
+            instance->bodySize = 0;
 
-            continue;
+            return;
         }
+    }
+
+    Encoder value;
+
+    encoder(&value, options.width);
+
+    unsigned char* output = NULL;
+    off_t recordSize = encoder_record_size(value);
+    off_t size = 0;
+
+    if (options.cache)
+    {
+        output = chunk_cache_find(
+            options.cache,
+            instance->hash,
+            instance->secondaryHash,
+            instance->inputSize,
+            &size);
+    }
+
+    if (output)
+    {
+        instance->output = output;
+    }
+    else
+    {
+        output = instance->output;
+        size = encoder_encode(
+            output,
+            &value,
+            instance->input,
+            instance->inputSize);
+    }
 
-        memcpy(instance->output + outputSize, &encoder, sizeof encoder);
+    if (options.entropy && instance->coded)
+    {
+        task_execute_entropy(instance, output, size, recordSize);
+    }
 
-        outputSize += sizeof encoder;
-        encoder.count = 1;
-        encoder.previous = current;
+    instance->first = value;
+    instance->first.count = 0;
+    instance->last = value;
+    instance->last.count = 0;
+    instance->outputSize = size;
+    instance->body = output + recordSize;
+    instance->bodySize = 0;
+
+    if (!size)
+    {
+        return;
     }
 
-    if (encoder.count)
+    encoder_read(&instance->first, output);
+
+    if (size < 2 * recordSize)
     {
-        memcpy(instance->output + outputSize, &encoder, sizeof encoder);
+        return;
+    }
+
+    encoder_read(&instance->last, output + size - recordSize);
 
-        outputSize += sizeof encoder;
+    instance->bodySize = size - 2 * recordSize;
+}
+
+bool task_complete(int* state)
+{
+    int previous = __atomic_exchange_n(
+        state,
+        TASK_STATE_COMPLETED,
+        __ATOMIC_ACQ_REL);
+
+    if (previous != TASK_STATE_WAITING)
+    {
+        return true;
     }
 
-    return outputSize;
+    return futex_wake(state);
+}
+
+bool task_is_completed(int* state)
+{
+    return __atomic_load_n(state, __ATOMIC_ACQUIRE) == TASK_STATE_COMPLETED;
+}
+
+bool task_wait(int* state)
+{
+    for (;;)
+    {
+        int value = TASK_STATE_PENDING;
+
+        if (__atomic_compare_exchange_n(
+            state,
+            &value,
+            TASK_STATE_WAITING,
+            false,
+            __ATOMIC_ACQUIRE,
+            __ATOMIC_ACQUIRE))
+        {
+            value = TASK_STATE_WAITING;
+        }
+
+        if (value == TASK_STATE_COMPLETED)
+        {
+            return true;
+        }
+
+        if (!futex_wait(state, TASK_STATE_WAITING))
+        {
+            return false;
+        }
+    }
 }
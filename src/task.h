@@ -1,18 +1,73 @@
-// thread_pool.h
+// task.h
 // Copyright (c) 2024 Ishan Pranav
 // Licensed under the MIT license.
 
+#ifndef TASK_ec31d90c9ef44360b12ef3c1618725d9
+#define TASK_ec31d90c9ef44360b12ef3c1618725d9
 #include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "encoder.h"
 #define TASK_SIZE 4096
+#define TASK_OUTPUT_SIZE (TASK_SIZE * 2)
+
+struct BlockTable;
+struct ChunkCache;
+
+/** Represents the options shared by all tasks. The cache is `NULL` unless
+ *  incremental encoding is enabled. The block table is `NULL` unless the output
+ *  is framed. Entropy coding applies only to framed output. */
+struct TaskOptions
+{
+    bool checksum;
+    bool framed;
+    bool entropy;
+    unsigned char width;
+    struct ChunkCache* cache;
+    struct BlockTable* blocks;
+};
+
+/** */
+typedef struct TaskOptions TaskOptions;
+
+/** Specifies the completion state of a task. */
+enum TaskState
+{
+    TASK_STATE_PENDING = 0,
+    TASK_STATE_WAITING,
+    TASK_STATE_COMPLETED
+};
 
 /** */
+typedef enum TaskState TaskState;
+
+/** Represents the metadata of a task. The output payload is stored separately
+ *  so that scanning task metadata does not touch the output buffers, and the
+ *  completion state is stored separately so that the writer, which polls it,
+ *  does not share cache lines with the metadata that workers write. The first
+ *  and last runs are kept out of the body so that the body is final as soon as
+ *  the task is completed. A task without input represents a hole: a run of
+ *  zero bytes that is never read from memory. The output may point into the
+ *  chunk cache rather than into the task's own output buffer. A task that
+ *  refers to an earlier task with an identical input is not encoded. The coded
+ *  size is zero unless entropy coding makes the output smaller. */
 struct Task
 {
     off_t inputSize;
     off_t outputSize;
+    off_t codedSize;
+    off_t bodySize;
     size_t id;
+    size_t reference;
+    uint32_t checksum;
+    uint64_t hash;
+    uint64_t secondaryHash;
+    Encoder first;
+    Encoder last;
     unsigned char* input;
-    unsigned char output[TASK_SIZE * 2];
+    unsigned char* output;
+    unsigned char* coded;
+    unsigned char* body;
 };
 
 /** */
@@ -21,6 +76,34 @@ typedef struct Task* Task;
 /**
  * 
  * @param instance
+ * @param options
+ */
+void task_execute(Task instance, TaskOptions options);
+
+/**
+ * Marks a task as completed, waking the writer only if it is blocked on this
+ * task.
+ * 
+ * @param state the completion state of the task.
+ * @return
+ */
+bool task_complete(int* state);
+
+/**
+ * Determines whether a task is completed without blocking.
+ * 
+ * @param state the completion state of the task.
+ * @return `true` if the task is completed; otherwise, `false`.
+ */
+bool task_is_completed(int* state);
+
+/**
+ * Blocks the calling thread until a task is completed. Returns immediately
+ * without a system call if the task is already completed.
+ * 
+ * @param state the completion state of the task.
  * @return
  */
-off_t task_execute(Task instance);
+bool task_wait(int* state);
+
+#endif
@@ -3,79 +3,497 @@
 // Licensed under the MIT license.
 
 // References:
+//  - https://www.man7.org/linux/man-pages/man2/mmap.2.html
 //  - https://www.man7.org/linux/man-pages/man3/pthread_mutex_init.3p.html
 
+// MAP_ANONYMOUS in <thread_pool.c>: _DEFAULT_SOURCE
+
+#define _DEFAULT_SOURCE
+#include <sys/mman.h>
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+#include "futex.h"
 #include "thread_pool.h"
 
-bool thread_pool(ThreadPool instance, MappedFileCollection mappedFiles)
+/** Represents the state of a pass over the input. Small files, file tails and
+ *  bytes that do not yet form a whole symbol are gathered as pending bytes at
+ *  the end of the staging buffer until they fill a whole task, or until an
+ *  extent of at least one whole task begins. */
+struct ThreadPoolSplitter
+{
+    struct Task* items;
+    int* states;
+    unsigned char* outputs;
+    unsigned char* staging;
+    size_t count;
+    size_t outputSize;
+    off_t stagingSize;
+    off_t width;
+    off_t pendingSize;
+};
+
+static void thread_pool_add(
+    struct ThreadPoolSplitter* splitter,
+    unsigned char* input,
+    off_t inputSize)
+{
+    size_t id = splitter->count;
+
+    splitter->count++;
+
+    if (!splitter->items)
+    {
+        return;
+    }
+
+    struct Task* item = splitter->items + id;
+
+    item->id = id;
+    item->input = input;
+    item->inputSize = inputSize;
+    item->output = splitter->outputs + id * splitter->outputSize;
+    item->coded = NULL;
+    item->codedSize = 0;
+    splitter->states[id] = TASK_STATE_PENDING;
+
+    if (splitter->outputSize > TASK_OUTPUT_SIZE)
+    {
+        item->coded = item->output + TASK_OUTPUT_SIZE;
+    }
+}
+
+static void thread_pool_add_pending(struct ThreadPoolSplitter* splitter)
+{
+    unsigned char* input = NULL;
+    off_t size = splitter->pendingSize;
+
+    if (splitter->staging)
+    {
+        input = splitter->staging + splitter->stagingSize;
+    }
+
+    splitter->stagingSize += size;
+    splitter->pendingSize = 0;
+
+    thread_pool_add(splitter, input, size);
+}
+
+static void thread_pool_append(
+    struct ThreadPoolSplitter* splitter,
+    unsigned char* buffer,
+    off_t size)
+{
+    if (splitter->staging)
+    {
+        unsigned char* pending = splitter->staging +
+            splitter->stagingSize +
+            splitter->pendingSize;
+
+        if (buffer)
+        {
+            memcpy(pending, buffer, size);
+        }
+        else
+        {
+            memset(pending, 0, size);
+        }
+    }
+
+    splitter->pendingSize += size;
+}
+
+static void thread_pool_split_data(
+    struct ThreadPoolSplitter* splitter,
+    unsigned char* buffer,
+    off_t size)
+{
+    if (splitter->pendingSize)
+    {
+        bool whole = size >= TASK_SIZE;
+        off_t missing = TASK_SIZE - splitter->pendingSize;
+
+        // An extent of at least one whole task is not used to fill pending
+        // bytes. Otherwise, its chunks would start at an offset that depends
+        // on the sizes of the earlier files, and identical files would no
+        // longer produce identical tasks for the block table and the cache.
+        // The pending bytes are only completed to a whole symbol and become
+        // a short task of their own.
+
+        if (whole)
+        {
+            off_t width = splitter->width;
+
+            missing = (width - splitter->pendingSize % width) % width;
+        }
+
+        if (missing > size)
+        {
+            missing = size;
+        }
+
+        thread_pool_append(splitter, buffer, missing);
+
+        buffer += missing;
+        size -= missing;
+
+        if (!whole && splitter->pendingSize < TASK_SIZE)
+        {
+            return;
+        }
+
+        thread_pool_add_pending(splitter);
+    }
+
+    off_t remainder = size % TASK_SIZE;
+
+    size -= remainder;
+
+    for (off_t offset = 0; offset < size; offset += TASK_SIZE)
+    {
+        thread_pool_add(splitter, buffer + offset, TASK_SIZE);
+    }
+
+    thread_pool_append(splitter, buffer + size, remainder);
+}
+
+static void thread_pool_split_hole(
+    struct ThreadPoolSplitter* splitter,
+    off_t size)
+{
+    if (!size)
+    {
+        return;
+    }
+
+    if (splitter->pendingSize)
+    {
+        off_t width = splitter->width;
+        off_t missing = (width - splitter->pendingSize % width) % width;
+
+        if (missing > size)
+        {
+            missing = size;
+        }
+
+        thread_pool_append(splitter, NULL, missing);
+
+        size -= missing;
+
+        if (splitter->pendingSize % width)
+        {
+            return;
+        }
+
+        thread_pool_add_pending(splitter);
+    }
+
+    off_t remainder = size % splitter->width;
+
+    size -= remainder;
+
+    if (size)
+    {
+        thread_pool_add(splitter, NULL, size);
+    }
+
+    thread_pool_append(splitter, NULL, remainder);
+}
+
+static void thread_pool_split_end(struct ThreadPoolSplitter* splitter)
 {
-    size_t count = 0;
+    off_t remainder = splitter->pendingSize % splitter->width;
+
+    if (splitter->pendingSize == remainder)
+    {
+        return;
+    }
+
+    splitter->pendingSize -= remainder;
 
+    thread_pool_add_pending(splitter);
+
+    splitter->pendingSize = remainder;
+}
+
+static void thread_pool_split(
+    struct ThreadPoolSplitter* splitter,
+    MappedFileCollection mappedFiles)
+{
     for (int i = 0; i < mappedFiles->count; i++)
     {
-        count += mappedFiles->items[i].size / TASK_SIZE;
+        MappedFile mappedFile = mappedFiles->items[i];
+        off_t position = 0;
+
+        for (int j = 0; j < mappedFile.extentCount; j++)
+        {
+            struct MappedExtent extent = mappedFile.extents[j];
+
+            thread_pool_split_hole(splitter, extent.offset - position);
+            thread_pool_split_data(
+                splitter,
+                mappedFile.buffer + extent.offset,
+                extent.size);
+
+            position = extent.offset + extent.size;
+        }
+
+        thread_pool_split_hole(splitter, mappedFile.size - position);
+    }
+
+    thread_pool_split_end(splitter);
+}
+
+static void* thread_pool_allocate(size_t size, bool shared)
+{
+    if (!shared)
+    {
+        return malloc(size);
+    }
+
+    if (!size)
+    {
+        return NULL;
+    }
+
+    void* result = mmap(
+        NULL,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS,
+        -1,
+        0);
+
+    if (result == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    return result;
+}
+
+static void thread_pool_free(void* buffer, size_t size, bool shared)
+{
+    if (!shared)
+    {
+        free(buffer);
+
+        return;
+    }
+
+    if (buffer)
+    {
+        munmap(buffer, size);
+    }
+}
+
+static void thread_pool_release_tasks(ThreadPool instance)
+{
+    size_t capacity = instance->capacity;
+    bool shared = instance->shared;
+
+    thread_pool_free(
+        instance->items,
+        capacity * sizeof * instance->items,
+        shared);
+    thread_pool_free(
+        instance->states,
+        capacity * sizeof * instance->states,
+        shared);
+    thread_pool_free(
+        instance->outputs,
+        capacity * instance->outputSize,
+        shared);
+
+    instance->items = NULL;
+    instance->states = NULL;
+    instance->outputs = NULL;
+    instance->capacity = 0;
+}
+
+static void thread_pool_release(ThreadPool instance)
+{
+    thread_pool_release_tasks(instance);
+    free(instance->staging);
+
+    instance->staging = NULL;
+    instance->stagingCapacity = 0;
+}
+
+static bool thread_pool_reserve(
+    ThreadPool instance,
+    size_t count,
+    off_t stagingSize)
+{
+    bool shared = instance->shared;
+
+    if (count > instance->capacity)
+    {
+        size_t outputSize = instance->outputSize;
+        size_t itemsSize = count * sizeof(struct Task);
+        size_t statesSize = count * sizeof(int);
+        struct Task* items = thread_pool_allocate(itemsSize, shared);
+        int* states = thread_pool_allocate(statesSize, shared);
+        unsigned char* outputs = thread_pool_allocate(
+            count * outputSize,
+            shared);
+
+        assert(items && states && outputs);
+
+        if (!items || !states || !outputs)
+        {
+            thread_pool_free(items, itemsSize, shared);
+            thread_pool_free(states, statesSize, shared);
+            thread_pool_free(outputs, count * outputSize, shared);
+
+            return false;
+        }
 
-        if (mappedFiles->items[i].size % TASK_SIZE != 0)
+        thread_pool_release_tasks(instance);
+
+        instance->items = items;
+        instance->states = states;
+        instance->outputs = outputs;
+        instance->capacity = count;
+    }
+
+    if (stagingSize > instance->stagingCapacity)
+    {
+        unsigned char* staging = malloc(stagingSize);
+
+        assert(staging);
+
+        if (!staging)
         {
-            count++;
+            return false;
         }
+
+        free(instance->staging);
+
+        instance->staging = staging;
+        instance->stagingCapacity = stagingSize;
     }
 
-    struct Task* items = malloc(count * sizeof * items);
+    return true;
+}
 
-    assert(items);
+static bool thread_pool_fill(
+    ThreadPool instance,
+    MappedFileCollection mappedFiles)
+{
+    struct ThreadPoolSplitter splitter =
+    {
+        .width = instance->options.width
+    };
 
-    if (!items)
+    thread_pool_split(&splitter, mappedFiles);
+
+    if (!thread_pool_reserve(
+        instance,
+        splitter.count,
+        splitter.stagingSize + splitter.pendingSize))
     {
         return false;
     }
 
-    instance->items = items;
-    instance->count = 0;
-    instance->index = 0;
-    instance->resultId = 0;
+    memset(&splitter, 0, sizeof splitter);
+
+    splitter.items = instance->items;
+    splitter.states = instance->states;
+    splitter.outputs = instance->outputs;
+    splitter.outputSize = instance->outputSize;
+    splitter.staging = instance->staging;
+    splitter.width = instance->options.width;
+
+    thread_pool_split(&splitter, mappedFiles);
+
+    instance->count = splitter.count;
     instance->flushId = 0;
-    instance->resultsCount = 0;
+    instance->tailSize = splitter.pendingSize;
 
-    int ex = pthread_mutex_init(&instance->mutex, NULL);
+    __atomic_store_n(&instance->index, 0, __ATOMIC_RELAXED);
 
-    assert(!ex);
+    if (splitter.pendingSize)
+    {
+        memcpy(
+            instance->tail,
+            instance->staging + splitter.stagingSize,
+            splitter.pendingSize);
+    }
 
-    if (ex)
+    return true;
+}
+
+bool thread_pool(
+    ThreadPool instance,
+    MappedFileCollection mappedFiles,
+    TaskOptions options,
+    bool shared)
+{
+    instance->items = NULL;
+    instance->states = NULL;
+    instance->outputs = NULL;
+    instance->outputSize = TASK_OUTPUT_SIZE;
+    instance->staging = NULL;
+    instance->capacity = 0;
+    instance->stagingCapacity = 0;
+    instance->shared = shared;
+    instance->options = options;
+    instance->workers = 0;
+    instance->output = stdout;
+    instance->checksum = 0;
+    instance->adaptive = false;
+    instance->maximum = INT_MAX;
+    instance->stalls = 0;
+    instance->active = INT_MAX;
+    instance->batch = 0;
+    instance->open = false;
+
+    if (options.entropy)
     {
-        free(items);
+        instance->outputSize *= 2;
+    }
 
-        errno = ex;
+    if (!thread_pool_fill(instance, mappedFiles))
+    {
+        thread_pool_release(instance);
 
         return false;
     }
 
-    ex = pthread_cond_init(&instance->producer, NULL);
+    encoder(&instance->carry, options.width);
 
-    assert(!ex);
+    if (options.checksum)
+    {
+        crc32c_shift(instance->shift, TASK_SIZE);
+    }
 
-    if (ex)
+    if (options.framed)
     {
-        free(items);
-        pthread_mutex_destroy(&instance->mutex);
+        if (!block_table(&instance->blocks, instance->items, instance->count))
+        {
+            thread_pool_release(instance);
 
-        errno = ex;
+            return false;
+        }
 
-        return false;
+        instance->options.blocks = &instance->blocks;
     }
 
-    ex = pthread_cond_init(&instance->consumer, NULL);
+    int ex = pthread_mutex_init(&instance->mutex, NULL);
 
     assert(!ex);
-    
+
     if (ex)
     {
-        free(items);
-        pthread_mutex_destroy(&instance->mutex);
-        pthread_cond_destroy(&instance->producer);
+        if (options.framed)
+        {
+            finalize_block_table(&instance->blocks);
+        }
+
+        thread_pool_release(instance);
 
         errno = ex;
 
@@ -85,40 +503,151 @@ bool thread_pool(ThreadPool instance, MappedFileCollection mappedFiles)
     return true;
 }
 
-bool thread_pool_dequeue(ThreadPool instance, Task* result)
+bool thread_pool_refill(ThreadPool instance, MappedFileCollection mappedFiles)
 {
+    assert(!instance->options.blocks);
     pthread_mutex_lock(&instance->mutex);
 
-    while (!instance->count)
+    bool result = thread_pool_fill(instance, mappedFiles);
+    int ex = errno;
+
+    instance->batch++;
+
+    pthread_mutex_unlock(&instance->mutex);
+
+    if (!futex_wake_all(&instance->batch))
     {
-        pthread_cond_wait(&instance->producer, &instance->mutex);
+        return false;
     }
 
-    if (instance->index >= instance->count)
+    errno = ex;
+
+    return result;
+}
+
+bool thread_pool_close(ThreadPool instance)
+{
+    pthread_mutex_lock(&instance->mutex);
+
+    instance->open = false;
+    instance->batch++;
+
+    pthread_mutex_unlock(&instance->mutex);
+
+    return futex_wake_all(&instance->batch) &&
+        thread_pool_resize(instance, INT_MAX);
+}
+
+int thread_pool_join(ThreadPool instance)
+{
+    return __atomic_fetch_add(&instance->workers, 1, __ATOMIC_RELAXED);
+}
+
+bool thread_pool_dequeue(ThreadPool instance, int worker, Task* result)
+{
+    for (;;)
     {
-        instance->resultId = instance->resultsCount;
+        int active = __atomic_load_n(&instance->active, __ATOMIC_ACQUIRE);
+
+        if (worker >= active)
+        {
+            if (!futex_wait(&instance->active, active))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        pthread_mutex_lock(&instance->mutex);
+
+        size_t index = instance->index;
+
+        // The index is also read without the lock by the writer, so it is
+        // stored atomically.
+
+        if (index < instance->count)
+        {
+            *result = instance->items + index;
+
+            __atomic_store_n(&instance->index, index + 1, __ATOMIC_RELAXED);
+
+            pthread_mutex_unlock(&instance->mutex);
+
+            return true;
+        }
+
+        bool open = instance->open;
+        int batch = instance->batch;
 
-        pthread_cond_signal(&instance->consumer);
         pthread_mutex_unlock(&instance->mutex);
 
-        return false;
+        if (!open)
+        {
+            return false;
+        }
+
+        if (!futex_wait(&instance->batch, batch))
+        {
+            return false;
+        }
     }
+}
 
-    *result = instance->items + instance->index;
-    instance->index++;
+bool thread_pool_resize(ThreadPool instance, int active)
+{
+    __atomic_store_n(&instance->active, active, __ATOMIC_RELEASE);
 
-    pthread_mutex_unlock(&instance->mutex);
+    return futex_wake_all(&instance->active);
+}
+
+bool thread_pool_adapt(ThreadPool instance, bool stalled)
+{
+    if (!instance->adaptive)
+    {
+        return true;
+    }
+
+    if (stalled)
+    {
+        instance->stalls++;
+    }
+
+    if (instance->flushId % THREAD_POOL_WINDOW)
+    {
+        return true;
+    }
+
+    int active = instance->active;
+    int stalls = instance->stalls;
+    size_t index = __atomic_load_n(&instance->index, __ATOMIC_RELAXED);
+    size_t backlog = index - instance->flushId;
+
+    instance->stalls = 0;
+
+    if (stalls > THREAD_POOL_WINDOW / 4 && active < instance->maximum)
+    {
+        return thread_pool_resize(instance, active + 1);
+    }
+
+    if (!stalls && backlog > 2 * THREAD_POOL_WINDOW && active > 1)
+    {
+        __atomic_store_n(&instance->active, active - 1, __ATOMIC_RELEASE);
+    }
 
     return true;
 }
 
 void finalize_thread_pool(ThreadPool instance)
 {
+    thread_pool_release(instance);
+    pthread_mutex_destroy(&instance->mutex);
+
     instance->count = 0;
     instance->index = 0;
 
-    free(instance->items);
-    pthread_mutex_destroy(&instance->mutex);
-    pthread_cond_destroy(&instance->producer);
-    pthread_cond_destroy(&instance->consumer);
+    if (instance->options.blocks)
+    {
+        finalize_block_table(&instance->blocks);
+    }
 }
@@ -3,21 +3,56 @@
 // Licensed under the MIT license.
 
 #include <pthread.h>
+#include "block_table.h"
+#include "crc32c.h"
 #include "mapped_file_collection.h"
 #include "task.h"
+#define CACHE_LINE_SIZE 64
+#define THREAD_POOL_WINDOW 64
 
-/** */
+/** Represents a thread pool. Padding only separates the fields written
+ *  without holding the mutex: the lock word itself, which workers contend
+ *  for, and the writer's flush state, which changes with every task. The index
+ *  is only written under the mutex, so it shares the line of the lock, as do
+ *  the active count and the batch number that workers read just before
+ *  taking it. Only workers whose number is less than the active count dequeue
+ *  tasks; the others are parked on the active count. Tasks and outputs of a
+ *  shared pool are mapped so that they remain shared with child processes. An
+ *  open pool can be refilled with the next batch of input, so its idle
+ *  workers wait on the batch number instead of returning. Completion states
+ *  are kept apart from the tasks, indexed by task identifier, so that the
+ *  writer polls a dense array that workers only touch to complete a task. */
 struct ThreadPool
 {
-    size_t index;
     size_t count;
-    size_t resultId;
-    size_t flushId;
-    size_t resultsCount;
-    pthread_mutex_t mutex;
-    pthread_cond_t producer;
-    pthread_cond_t consumer;
+    size_t capacity;
+    TaskOptions options;
     struct Task* items;
+    int* states;
+    unsigned char* outputs;
+    size_t outputSize;
+    unsigned char* staging;
+    off_t stagingCapacity;
+    bool shared;
+    off_t tailSize;
+    unsigned char tail[ENCODER_MAX_WIDTH];
+    struct BlockTable blocks;
+    unsigned char sharedPadding[CACHE_LINE_SIZE];
+    pthread_mutex_t mutex;
+    size_t index;
+    int workers;
+    int active;
+    int batch;
+    bool open;
+    unsigned char mutexPadding[CACHE_LINE_SIZE];
+    size_t flushId;
+    FILE* output;
+    Encoder carry;
+    uint32_t checksum;
+    uint32_t shift[CRC32C_BITS];
+    bool adaptive;
+    int maximum;
+    int stalls;
 };
 
 /** */
@@ -28,17 +63,74 @@ typedef struct ThreadPool* ThreadPool;
  * 
  * @param instance
  * @param mappedFiles
+ * @param options
+ * @param shared whether tasks and outputs are shared with child processes.
  * @return 
  */
-bool thread_pool(ThreadPool instance, MappedFileCollection mappedFiles);
+bool thread_pool(
+    ThreadPool instance,
+    MappedFileCollection mappedFiles,
+    TaskOptions options,
+    bool shared);
+
+/**
+ * Replaces the tasks of an open pool with the tasks of the next batch and
+ * wakes the waiting workers. Every task of the previous batch must be flushed.
+ * Buffers are reused and only grow. A framed pool cannot be refilled.
+ * 
+ * @param instance
+ * @param mappedFiles the next batch.
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool thread_pool_refill(ThreadPool instance, MappedFileCollection mappedFiles);
+
+/**
+ * Closes the pool so that every worker returns once no task is left, and
+ * wakes any waiting or parked workers.
+ * 
+ * @param instance
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool thread_pool_close(ThreadPool instance);
+
+/**
+ * Assigns the next worker number to the calling worker.
+ * 
+ * @param instance
+ * @return The worker number.
+ */
+int thread_pool_join(ThreadPool instance);
 
 /**
  * 
  * @param instance
+ * @param worker the worker number.
  * @param result
  * @return
  */
-bool thread_pool_dequeue(ThreadPool instance, Task* result);
+bool thread_pool_dequeue(ThreadPool instance, int worker, Task* result);
+
+/**
+ * Sets the number of workers that may dequeue tasks and wakes any parked
+ * workers.
+ * 
+ * @param instance
+ * @param active the number of active workers.
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool thread_pool_resize(ThreadPool instance, int active);
+
+/**
+ * Records whether the writer had to wait for the next task, and adjusts the
+ * number of active workers at the end of each window of tasks. Workers are
+ * added while the writer waits for them and removed while completed tasks
+ * pile up ahead of the writer.
+ * 
+ * @param instance
+ * @param stalled whether the writer had to wait for the next task.
+ * @return `true` if successful; otherwise, `false`.
+ */
+bool thread_pool_adapt(ThreadPool instance, bool stalled);
 
 /**
  * 
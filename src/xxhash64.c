@@ -0,0 +1,126 @@
+// xxhash64.c
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://github.com/Cyan4973/xxHash/blob/v0.8.2/doc/xxhash_spec.md
+
+#include "xxhash64.h"
+#define XXHASH64_PRIME_1 UINT64_C(0x9e3779b185ebca87)
+#define XXHASH64_PRIME_2 UINT64_C(0xc2b2ae3d27d4eb4f)
+#define XXHASH64_PRIME_3 UINT64_C(0x165667b19e3779f9)
+#define XXHASH64_PRIME_4 UINT64_C(0x85ebca77c2b2ae63)
+#define XXHASH64_PRIME_5 UINT64_C(0x27d4eb2f165667c5)
+
+static inline uint64_t xxhash64_rotate(uint64_t value, int count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+static inline uint64_t xxhash64_read64(const unsigned char buffer[])
+{
+    uint64_t result = 0;
+
+    for (int i = 7; i >= 0; i--)
+    {
+        result = (result << 8) | buffer[i];
+    }
+
+    return result;
+}
+
+static inline uint64_t xxhash64_read32(const unsigned char buffer[])
+{
+    return (uint64_t)buffer[0] | 
+        (uint64_t)buffer[1] << 8 | 
+        (uint64_t)buffer[2] << 16 | 
+        (uint64_t)buffer[3] << 24;
+}
+
+static inline uint64_t xxhash64_round(uint64_t accumulator, uint64_t lane)
+{
+    accumulator += lane * XXHASH64_PRIME_2;
+    accumulator = xxhash64_rotate(accumulator, 31);
+
+    return accumulator * XXHASH64_PRIME_1;
+}
+
+static inline uint64_t xxhash64_merge(uint64_t accumulator, uint64_t lane)
+{
+    accumulator ^= xxhash64_round(0, lane);
+
+    return accumulator * XXHASH64_PRIME_1 + XXHASH64_PRIME_4;
+}
+
+uint64_t xxhash64(uint64_t seed, const unsigned char buffer[], off_t size)
+{
+    off_t i = 0;
+    uint64_t result;
+
+    if (size >= 32)
+    {
+        uint64_t lanes[4] =
+        {
+            seed + XXHASH64_PRIME_1 + XXHASH64_PRIME_2,
+            seed + XXHASH64_PRIME_2,
+            seed,
+            seed - XXHASH64_PRIME_1
+        };
+
+        for (; i + 32 <= size; i += 32)
+        {
+            for (int lane = 0; lane < 4; lane++)
+            {
+                lanes[lane] = xxhash64_round(
+                    lanes[lane],
+                    xxhash64_read64(buffer + i + lane * 8));
+            }
+        }
+
+        result = 
+            xxhash64_rotate(lanes[0], 1) + 
+            xxhash64_rotate(lanes[1], 7) +
+            xxhash64_rotate(lanes[2], 12) + 
+            xxhash64_rotate(lanes[3], 18);
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            result = xxhash64_merge(result, lanes[lane]);
+        }
+    }
+    else
+    {
+        result = seed + XXHASH64_PRIME_5;
+    }
+
+    result += size;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        result ^= xxhash64_round(0, xxhash64_read64(buffer + i));
+        result = xxhash64_rotate(result, 27) * XXHASH64_PRIME_1;
+        result += XXHASH64_PRIME_4;
+    }
+
+    if (i + 4 <= size)
+    {
+        result ^= xxhash64_read32(buffer + i) * XXHASH64_PRIME_1;
+        result = xxhash64_rotate(result, 23) * XXHASH64_PRIME_2;
+        result += XXHASH64_PRIME_3;
+        i += 4;
+    }
+
+    for (; i < size; i++)
+    {
+        result ^= buffer[i] * XXHASH64_PRIME_5;
+        result = xxhash64_rotate(result, 11) * XXHASH64_PRIME_1;
+    }
+
+    result ^= result >> 33;
+    result *= XXHASH64_PRIME_2;
+    result ^= result >> 29;
+    result *= XXHASH64_PRIME_3;
+    result ^= result >> 32;
+
+    return result;
+}
@@ -0,0 +1,23 @@
+// xxhash64.h
+// Copyright (c) 2024 Ishan Pranav
+// Licensed under the MIT license.
+
+// References:
+//  - https://github.com/Cyan4973/xxHash/blob/v0.8.2/doc/xxhash_spec.md
+
+#ifndef XXHASH64_88915668d19f4f6c92c9fcc1f1a87396
+#define XXHASH64_88915668d19f4f6c92c9fcc1f1a87396
+#include <sys/types.h>
+#include <stdint.h>
+
+/**
+ * Computes the 64-bit xxHash of the given bytes.
+ * 
+ * @param seed
+ * @param buffer
+ * @param size
+ * @return The hash.
+ */
+uint64_t xxhash64(uint64_t seed, const unsigned char buffer[], off_t size);
+
+#endif
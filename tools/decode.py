@@ -0,0 +1,250 @@
+# decode.py
+# Copyright (c) 2024 Ishan Pranav
+# Licensed under the MIT license.
+
+# A reference decoder for the output of nyuenc. It favors clarity over speed.
+#
+# Usage: python3 decode.py [-F] [-w WIDTH] FILE
+
+from argparse import ArgumentParser
+from concurrent.futures import ProcessPoolExecutor
+from struct import unpack_from
+import sys
+
+FRAME_MAGIC = b"NYUF"
+FRAME_VERSION = 1
+FRAME_TYPE_LITERAL = 0
+FRAME_TYPE_REFERENCE = 1
+FRAME_TYPE_HOLE = 2
+FRAME_TYPE_END = 3
+FRAME_TYPE_HUFFMAN = 4
+FRAME_TYPE_CHECKSUMS = 5
+CRC32C_POLYNOMIAL = 0x82F63B78
+HUFFMAN_SYMBOLS = 256
+HUFFMAN_MAX_LENGTH = 15
+HUFFMAN_TABLE_SIZE = HUFFMAN_SYMBOLS // 2
+
+
+def crc32c_table():
+    table = []
+
+    for i in range(256):
+        value = i
+
+        for _ in range(8):
+            value = (value >> 1) ^ (CRC32C_POLYNOMIAL if value & 1 else 0)
+
+        table.append(value)
+
+    return table
+
+
+CRC32C_TABLE = crc32c_table()
+
+
+def crc32c(data):
+    """Returns the CRC-32C (Castagnoli) checksum of the data."""
+    value = 0xFFFFFFFF
+
+    for byte in data:
+        value = CRC32C_TABLE[(value ^ byte) & 0xFF] ^ (value >> 8)
+
+    return value ^ 0xFFFFFFFF
+
+
+def verify_checksums(blocks, checksums):
+    """Checks each block against its checksum. Blocks are verified in
+    parallel, one process per processor."""
+    if len(blocks) != len(checksums):
+        raise ValueError(f"{len(checksums)} checksums for {len(blocks)} frames")
+
+    with ProcessPoolExecutor() as executor:
+        actual = executor.map(crc32c, blocks, chunksize=16)
+
+        for index, (value, expected) in enumerate(zip(actual, checksums)):
+            if value != expected:
+                raise ValueError(f"checksum mismatch in frame {index}")
+
+
+def decode_runs(data, width=1):
+    """Decodes records of `width` symbol bytes and one count byte, followed by
+    a trailing partial symbol of fewer than `width` bytes."""
+    record_size = width + 1
+    end = len(data) - len(data) % record_size
+    result = bytearray()
+
+    for i in range(0, end, record_size):
+        count = data[i + width]
+
+        if not count:
+            raise ValueError(f"empty run at offset {i}")
+
+        result += data[i:i + width] * count
+
+    result += data[end:]
+
+    return bytes(result)
+
+
+def decode_huffman(data, count):
+    """Decodes `count` symbols coded with a canonical Huffman code. The data
+    begins with the table of 4-bit code lengths, even symbols in the low bits;
+    the codes follow, most significant bit first."""
+    lengths = []
+
+    for byte in data[:HUFFMAN_TABLE_SIZE]:
+        lengths += [byte & 0xF, byte >> 4]
+
+    # Canonical codes are assigned in order of length, then of symbol.
+
+    counts = [0] * (HUFFMAN_MAX_LENGTH + 1)
+
+    for length in lengths:
+        counts[length] += 1
+
+    counts[0] = 0
+    code = 0
+    next_code = [0] * (HUFFMAN_MAX_LENGTH + 1)
+
+    for length in range(1, HUFFMAN_MAX_LENGTH + 1):
+        code = (code + counts[length - 1]) << 1
+        next_code[length] = code
+
+    symbols = {}
+
+    for symbol, length in enumerate(lengths):
+        if length:
+            symbols[(length, next_code[length])] = symbol
+            next_code[length] += 1
+
+    result = bytearray()
+    position = HUFFMAN_TABLE_SIZE * 8
+
+    while len(result) < count:
+        code = 0
+
+        for length in range(1, HUFFMAN_MAX_LENGTH + 1):
+            byte = data[position // 8]
+            code = (code << 1) | ((byte >> (7 - position % 8)) & 1)
+            position += 1
+
+            if (length, code) in symbols:
+                result.append(symbols[(length, code)])
+
+                break
+        else:
+            raise ValueError("invalid Huffman code")
+
+    return bytes(result)
+
+
+def decode_huffman_block(data, width):
+    """Rebuilds the records of a Huffman frame from its symbol and count
+    streams and decodes them."""
+    records, symbol_size = unpack_from("<II", data, 0)
+    symbols = decode_huffman(data[8:8 + symbol_size], records * width)
+    counts = decode_huffman(data[8 + symbol_size:], records)
+    block = bytearray()
+
+    for i in range(records):
+        block += symbols[i * width:(i + 1) * width]
+        block.append(counts[i])
+
+    return decode_runs(bytes(block), width)
+
+
+def read_frames(data):
+    """Yields the type and the decoded block of each frame of the framed format
+    written by `nyuenc -F` or `nyuenc -H`. The end frame yields the trailing
+    partial symbol. The blocks are verified against the checksum frame, if
+    any, before the end frame is yielded."""
+    if data[:4] != FRAME_MAGIC or len(data) < 6:
+        raise ValueError("not a framed stream")
+
+    if data[4] != FRAME_VERSION:
+        raise ValueError(f"unsupported version {data[4]}")
+
+    width = data[5]
+    offset = 6
+    frames = []
+
+    while True:
+        frame_type = data[offset]
+        offset += 1
+
+        if frame_type == FRAME_TYPE_LITERAL:
+            size = unpack_from("<I", data, offset)[0]
+            offset += 4
+            block = decode_runs(data[offset:offset + size], width)
+            offset += size
+        elif frame_type == FRAME_TYPE_REFERENCE:
+            index = unpack_from("<Q", data, offset)[0]
+            offset += 8
+
+            if index >= len(frames):
+                raise ValueError(f"reference to frame {index} is not earlier")
+
+            block = frames[index]
+        elif frame_type == FRAME_TYPE_HOLE:
+            size = unpack_from("<Q", data, offset)[0]
+            offset += 8
+            block = bytes(size)
+        elif frame_type == FRAME_TYPE_HUFFMAN:
+            size = unpack_from("<I", data, offset)[0]
+            offset += 4
+            block = decode_huffman_block(data[offset:offset + size], width)
+            offset += size
+        elif frame_type == FRAME_TYPE_CHECKSUMS:
+            count = unpack_from("<Q", data, offset)[0]
+            offset += 8
+            checksums = unpack_from(f"<{count}I", data, offset)
+            offset += 4 * count
+
+            verify_checksums(frames, checksums)
+
+            continue
+        elif frame_type == FRAME_TYPE_END:
+            size = data[offset]
+            offset += 1
+            block = data[offset:offset + size]
+            offset += size
+
+            if offset != len(data):
+                raise ValueError("trailing bytes after the end frame")
+
+            yield frame_type, block
+
+            return
+        else:
+            raise ValueError(f"unknown frame type {frame_type}")
+
+        frames.append(block)
+
+        yield frame_type, block
+
+
+def decode_frames(data):
+    """Decodes the framed format written by `nyuenc -F` or `nyuenc -H`."""
+    return b"".join(block for _, block in read_frames(data))
+
+
+def decode(data, width=1, framed=False):
+    if framed:
+        return decode_frames(data)
+
+    return decode_runs(data, width)
+
+
+if __name__ == "__main__":
+    parser = ArgumentParser(description="Decodes the output of nyuenc.")
+    parser.add_argument("-F", "-H", dest="framed", action="store_true",
+                        help="decode the framed format")
+    parser.add_argument("-w", dest="width", type=int, default=1,
+                        help="the symbol width of the unframed format")
+    parser.add_argument("path")
+    arguments = parser.parse_args()
+
+    with open(arguments.path, "rb") as input:
+        data = input.read()
+
+    sys.stdout.buffer.write(decode(data, arguments.width, arguments.framed))
@@ -0,0 +1,279 @@
+# round_trip_test.py
+# Copyright (c) 2024 Ishan Pranav
+# Licensed under the MIT license.
+
+# Encodes generated inputs with nyuenc in each mode, at each symbol width and
+# with threads, shards and direct I/O, and checks that the reference decoder
+# restores them. Each run is repeated with -c, which checks the checksum file and, for
+# framed output, the checksum frame. Each case is also encoded twice with the
+# same chunk cache.
+#
+# Usage: python3 round_trip_test.py NYUENC
+
+from os import path, remove
+from random import Random
+from subprocess import PIPE, run
+from tempfile import TemporaryDirectory
+import sys
+
+from decode import FRAME_TYPE_REFERENCE, crc32c, decode, read_frames
+
+TASK_SIZE = 4096
+# Threads with -j, processes with -p, or threads reading and writing without
+# the page cache with --direct. The last shard count is larger than the number
+# of tasks of any case, so that some shards are empty. Direct encoding only
+# produces plain output.
+PARALLELISM = [
+    ["-j", "1"],
+    ["-j", "3"],
+    ["-p", "1"],
+    ["-p", "3"],
+    ["-p", "16"],
+    ["--direct", "-j", "1"],
+    ["--direct", "-j", "3"]
+]
+CHECKSUMS = [False, True]
+WIDTHS = [1, 2, 4, 8]
+MODES = [
+    ("plain", []),
+    ("framed", ["-F"]),
+    ("entropy-coded", ["-H"])
+]
+
+
+def runs(symbols, lengths):
+    result = bytearray()
+
+    for i, length in enumerate(lengths):
+        result += symbols[i % len(symbols)] * length
+
+    return bytes(result)
+
+
+def symbol(value, width):
+    return bytes((value + i) % 256 for i in range(width))
+
+
+def generate_cases(random, width):
+    """Returns (name, files) pairs. A file is a list of (offset, bytes) pieces
+    followed by its total size; the gaps between pieces are holes. Run lengths
+    are counted in symbols of the given width, so that the runs cross task
+    seams at every width."""
+    symbols = [symbol(ord("a"), width), symbol(ord("b"), width)]
+    task = TASK_SIZE // width
+    seams = runs(symbols, [
+        1, 255, 256, 257, task - 1, task, task + 1,
+        2 * task - 3, 3, 510, 2 * task + 7, 1
+    ])
+    choices = [symbols[0]] * 6 + [symbols[1], bytes(width)]
+    skewed = b"".join(random.choice(choices) for _ in range(5 * task))
+    block = bytes(random.randrange(256) for _ in range(TASK_SIZE))
+    duplicates = block * 6 + seams[:TASK_SIZE] + block * 2 + b"tail"
+    small = [runs([b"x", b"y"], [random.randrange(1, 50) for _ in
+                                 range(random.randrange(1, 4))])
+             for _ in range(40)]
+
+    def whole(data):
+        return ([(0, data)], len(data))
+
+    return [
+        ("empty", [whole(b"")]),
+        ("one byte", [whole(b"a")]),
+        ("seams", [whole(seams)]),
+        ("seams split across files", [whole(seams[:5003]),
+                                      whole(seams[5003:])]),
+        ("skewed", [whole(skewed), whole(b""), whole(skewed[:777])]),
+        ("duplicates", [whole(duplicates)]),
+        ("small files", [whole(data) for data in small]),
+        ("sparse", [([(0, skewed[:5000]), (1 << 20, block)], (2 << 20) + 17),
+                    whole(b"z" * 9)])
+    ]
+
+
+def write_files(directory, name, files):
+    paths = []
+    expected = bytearray()
+
+    for i, (pieces, size) in enumerate(files):
+        file_path = path.join(directory, f"{name.replace(' ', '_')}.{i}")
+
+        with open(file_path, "wb") as output:
+            for offset, data in pieces:
+                output.seek(offset)
+                output.write(data)
+
+            output.truncate(size)
+
+        with open(file_path, "rb") as input:
+            expected += input.read()
+
+        paths.append(file_path)
+
+    return paths, bytes(expected)
+
+
+def check(executable, paths, expected, width, options, parallelism,
+          checksum):
+    """Returns None if the round trip succeeds; otherwise, the error."""
+    command = [executable, "-w", str(width)] + parallelism + options
+    directory = path.dirname(paths[0])
+    checksum_path = path.join(directory, "checksum")
+    output_path = path.join(directory, "output")
+
+    if checksum:
+        command += ["-c", checksum_path]
+
+    # The output is a regular file, so that --direct writes it directly.
+
+    with open(output_path, "wb") as output:
+        completed = run(command + paths, stdout=output, stderr=PIPE)
+
+    try:
+        if completed.returncode:
+            raise ValueError(completed.stderr.decode().strip())
+
+        with open(output_path, "rb") as input:
+            actual = decode(input.read(), width, bool(options))
+
+        if actual != expected:
+            raise ValueError("decoded output differs")
+
+        if checksum:
+            with open(checksum_path) as input:
+                value = input.read()
+
+            if value != f"{crc32c(expected):08x}\n":
+                raise ValueError(f"checksum file differs: {value.strip()}")
+    except Exception as error:
+        return error
+
+    return None
+
+
+def check_cache(executable, paths, expected, width, options):
+    """Returns None if encoding twice with the same chunk cache gives the same
+    output, which decodes to the input; otherwise, the error."""
+    cache_path = path.join(path.dirname(paths[0]), "cache")
+    command = [executable, "-j", "3", "-w", str(width), "-C", cache_path]
+    outputs = []
+
+    if path.exists(cache_path):
+        remove(cache_path)
+
+    try:
+        for _ in range(2):
+            completed = run(command + options + paths, capture_output=True)
+
+            if completed.returncode:
+                raise ValueError(completed.stderr.decode().strip())
+
+            outputs.append(completed.stdout)
+
+        if not path.exists(cache_path):
+            raise ValueError("no cache was saved")
+
+        if outputs[1] != outputs[0]:
+            raise ValueError("cached output differs")
+
+        if decode(outputs[1], width, bool(options)) != expected:
+            raise ValueError("decoded output differs")
+    except Exception as error:
+        return error
+
+    return None
+
+
+def check_references(executable, directory, width, options):
+    """Returns None if a file that follows small files of odd sizes is still
+    encoded as references to an identical earlier file; otherwise, the
+    error."""
+    random = Random(width)
+    block = bytes(random.randrange(256) for _ in range(10 * TASK_SIZE))
+    files = [
+        ([(0, b"a" * (101 * width))], 101 * width),
+        ([(0, block)], len(block)),
+        ([(0, b"b" * (51 * width))], 51 * width),
+        ([(0, block)], len(block))
+    ]
+    paths, expected = write_files(directory, "references", files)
+    command = [executable, "-w", str(width)] + options + paths
+    completed = run(command, capture_output=True)
+
+    try:
+        if completed.returncode:
+            raise ValueError(completed.stderr.decode().strip())
+
+        frames = list(read_frames(completed.stdout))
+        references = sum(frame_type == FRAME_TYPE_REFERENCE
+                         for frame_type, _ in frames)
+
+        if b"".join(block for _, block in frames) != expected:
+            raise ValueError("decoded output differs")
+
+        if references < len(block) // TASK_SIZE:
+            raise ValueError(f"only {references} reference frames")
+    except Exception as error:
+        return error
+
+    return None
+
+
+def main(arguments):
+    if len(arguments) != 2:
+        print(f"Usage: python3 {arguments[0]} NYUENC", file=sys.stderr)
+
+        return 2
+
+    executable = path.abspath(arguments[1])
+    failures = 0
+    checks = 0
+
+    with TemporaryDirectory() as directory:
+        for width in WIDTHS:
+            for name, files in generate_cases(Random(202), width):
+                paths, expected = write_files(directory, name, files)
+
+                for mode, options in MODES:
+                    for parallelism in PARALLELISM:
+                        if options and "--direct" in parallelism:
+                            continue
+
+                        for checksum in CHECKSUMS:
+                            checks += 1
+                            error = check(executable, paths, expected, width,
+                                          options, parallelism, checksum)
+
+                            if error:
+                                failures += 1
+                                flags = " ".join(parallelism)
+
+                                if checksum:
+                                    flags += " -c"
+
+                                print(f"FAIL {name}, {mode}, -w {width}, "
+                                      f"{flags}: {error}")
+
+                    checks += 1
+                    error = check_cache(executable, paths, expected, width,
+                                        options)
+
+                    if error:
+                        failures += 1
+                        print(f"FAIL {name}, {mode}, -w {width}, -C: {error}")
+
+            for mode, options in MODES[1:]:
+                checks += 1
+                error = check_references(executable, directory, width,
+                                         options)
+
+                if error:
+                    failures += 1
+                    print(f"FAIL references, {mode}, -w {width}: {error}")
+
+    print(f"{checks - failures} of {checks} round trips passed")
+
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))